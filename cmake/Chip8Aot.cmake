@@ -0,0 +1,31 @@
+# chip8_aot_roms(<target> [QUIRKS <profile>] ROMS <rom>...)
+#
+# Translates each ROM with chip8_aot at build time and compiles the result
+# into <target>, where chip8 instances in dispatchMode::native pick it up
+# (for that quirk profile, legacy by default). The ROMs are translated
+# again whenever they or chip8_aot change.
+function(chip8_aot_roms target)
+    cmake_parse_arguments(AOT "" "QUIRKS" "ROMS" ${ARGN})
+    if (NOT AOT_QUIRKS)
+        set(AOT_QUIRKS legacy)
+    endif()
+
+    set(output_dir ${CMAKE_CURRENT_BINARY_DIR}/aot/${target})
+    file(MAKE_DIRECTORY ${output_dir})
+
+    foreach (rom ${AOT_ROMS})
+        get_filename_component(rom_path ${rom} ABSOLUTE)
+        get_filename_component(rom_name ${rom} NAME_WE)
+        string(MAKE_C_IDENTIFIER ${rom_name} rom_id)
+        set(output ${output_dir}/${rom_id}_${AOT_QUIRKS}.cpp)
+
+        add_custom_command(
+                OUTPUT ${output}
+                COMMAND chip8_aot --quirks ${AOT_QUIRKS} --name ${rom_name} -o ${output} ${rom_path}
+                DEPENDS chip8_aot ${rom_path}
+                COMMENT "Translating ${rom_name} (${AOT_QUIRKS} quirks)"
+                VERBATIM
+        )
+        target_sources(${target} PRIVATE ${output})
+    endforeach()
+endfunction()
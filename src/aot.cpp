@@ -0,0 +1,25 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "aot.hpp"
+#include <vector>
+
+// Filled during static initialization, read-only afterwards
+static std::vector<const aotModule*>& registry() {
+    static std::vector<const aotModule*> modules;
+    return modules;
+}
+
+bool registerAotModule(const aotModule& module) {
+    registry().push_back(&module);
+    return true;
+}
+
+const aotModule* findAotModule(uint64_t romHash, quirkProfile quirks) {
+    for (const aotModule* module : registry()) {
+        if (module->romHash == romHash && module->quirks == quirks)
+            return module;
+    }
+    return nullptr;
+}
@@ -0,0 +1,57 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_AOT_HPP
+#define CHIP8_EMULATOR_AOT_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/*
+    Runtime side of chip8_aot, the ahead-of-time ROM translator.
+
+    chip8_aot walks a ROM's reachable code and writes a C++ file with one
+    function over the chip8 state: a loop over a switch on PC, with a case
+    per basic block and the operands and quirks folded in. Linked into a
+    program (see chip8_aot_roms() in cmake/Chip8Aot.cmake), the file
+    registers itself here, and instances in dispatchMode::native running
+    that ROM on that quirk profile run it. Addresses nothing was
+    translated for, and code that no longer matches the ROM
+    (self-modifying code), run one instruction at a time through the
+    core's handlers, so results are the same as in every other mode.
+*/
+
+struct aotBlock {
+    uint16_t start;     // address of the first instruction
+    uint16_t bytes;     // code bytes translated, from start
+    uint64_t pages;     // 64-byte code pages those bytes sit in
+};
+
+struct aotModule {
+    const char* name;
+    uint64_t romHash;               // chip8::hashROM of the image
+    quirkProfile quirks;
+    const uint8_t* image;           // the ROM, as loaded at 0x200
+    size_t imageSize;
+    const aotBlock* blocks;
+    size_t blockCount;
+
+    // Run translated blocks from PC for at most `cycles` instructions;
+    // returns how many ran. Stops early where there is no block to run,
+    // and after a block that stopped the core (fault, FX0A, idle loop).
+    uint64_t (*run)(chip8& c, uint64_t cycles);
+};
+
+// Called from the static initializers of generated files
+bool registerAotModule(const aotModule& module);
+
+// The module translated from this ROM for this profile, or nullptr
+const aotModule* findAotModule(uint64_t romHash, quirkProfile quirks);
+
+// Generated code lives in specializations of this (a friend of chip8)
+template <typename Tag>
+struct aotCode;
+
+#endif // CHIP8_EMULATOR_AOT_HPP
@@ -0,0 +1,652 @@
+//
+// Created by patel on 2026-10-16.
+//
+// chip8_aot: translate a ROM ahead of time into C++ for dispatchMode::native
+// (see aot.hpp).
+//
+//     chip8_aot [--quirks legacy|chip8|schip|xochip] [--name id] [-o out.cpp] <rom>
+//
+// The code reachable from 0x200 is found by following fall-through, jump,
+// call, return-address and skip edges; BNNN targets are only known at run
+// time and are left to the interpreter. Every basic block becomes one case
+// of a switch on PC, with its operands and the profile's quirks folded in;
+// a block that always goes on to another one jumps straight to it. Drawing,
+// memory stores and the other heavy instructions call the core's own
+// handlers, decoded once.
+//
+
+#include "chip8.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Longest block, as in the core's block mode
+static const size_t MAX_BLOCK_LENGTH = 64;
+
+/* -------------------- PROFILE -------------------- */
+
+// The quirk flags of a profile, as run-time values for the generator
+struct quirkFlags {
+    bool shiftUsesVY;
+    bool logicResetsVF;
+    bool jumpUsesVX;
+    bool indexOverflowFlag;
+    bool superChip;
+    bool xoChip;
+};
+
+template <typename Q>
+static quirkFlags flagsOf() {
+    return { Q::shiftUsesVY, Q::logicResetsVF, Q::jumpUsesVX, Q::indexOverflowFlag,
+             Q::superChip, Q::xoChip };
+}
+
+static quirkFlags flagsOf(quirkProfile profile) {
+    switch (profile) {
+        case quirkProfile::legacy: return flagsOf<legacyQuirks>();
+        case quirkProfile::chip8:  return flagsOf<chip8Quirks>();
+        case quirkProfile::schip:  return flagsOf<schipQuirks>();
+        case quirkProfile::xochip: return flagsOf<xochipQuirks>();
+    }
+    return flagsOf<legacyQuirks>();
+}
+
+/* -------------------- INSTRUCTIONS -------------------- */
+
+enum class opKind {
+    simple,     // translated inline, on to the next instruction
+    control,    // translated inline, ends the block (jumps, calls, skips, 00EE)
+    handler,    // the core's handler, on to the next instruction
+    handlerEnd  // the core's handler, ends the block: may write memory,
+                // fault or wait (DXYN, FX0A, stores, unknown opcodes)
+};
+
+static opKind kindOf(uint16_t opcode, const quirkFlags& q) {
+    uint8_t n = opcode & 0xF;
+    uint8_t nn = opcode & 0xFF;
+
+    switch (opcode >> 12) {
+        case 0x0:
+            if (opcode == 0x00EE)
+                return opKind::control;
+            if (opcode == 0x00E0)
+                return opKind::handler;
+            if (q.superChip && ((opcode & 0xFFF0) == 0x00C0 || opcode == 0x00FB || opcode == 0x00FC
+                                || opcode == 0x00FE || opcode == 0x00FF))
+                return opKind::handler;
+            return opKind::handlerEnd;
+        case 0x1: case 0x2: case 0x3: case 0x4: case 0xB:
+            return opKind::control;
+        case 0x5:
+            if (n == 0)
+                return opKind::control;
+            if (q.xoChip && n == 3)
+                return opKind::handler;
+            return opKind::handlerEnd;
+        case 0x9:
+            return n == 0 ? opKind::control : opKind::handlerEnd;
+        case 0x6: case 0x7: case 0x8: case 0xA: case 0xC:
+            return opKind::simple;
+        case 0xE:
+            return (nn == 0x9E || nn == 0xA1) ? opKind::control : opKind::handlerEnd;
+        case 0xF:
+            switch (nn) {
+                case 0x07: case 0x15: case 0x18: case 0x1E: case 0x29:
+                    return opKind::simple;
+            }
+            if (q.xoChip && (opcode == 0xF000 || nn == 0x01 || opcode == 0xF002 || nn == 0x3A))
+                return opKind::handler;
+            return opKind::handlerEnd;
+        default:
+            return opKind::handlerEnd;
+    }
+}
+
+/* -------------------- ROM -------------------- */
+
+struct romImage {
+    std::vector<uint8_t> bytes;
+
+    // Code can only run below 0x1000
+    uint16_t end() const {
+        return static_cast<uint16_t>(std::min<size_t>(0x200 + bytes.size(), CODE_SIZE));
+    }
+
+    bool holds(uint16_t addr, int length = 2) const {
+        return addr >= 0x200 && addr + length <= end();
+    }
+
+    uint16_t fetch(uint16_t addr) const {
+        return static_cast<uint16_t>(bytes[addr - 0x200] << 8 | bytes[addr + 1 - 0x200]);
+    }
+};
+
+struct translatedBlock {
+    uint16_t start;
+    uint16_t end;
+    std::vector<uint16_t> addrs;
+
+    uint64_t pages() const {
+        uint64_t bits = 0;
+        for (unsigned addr = start; addr < end; ++addr)
+            bits |= 1ull << (addr / 64);
+        return bits;
+    }
+};
+
+// Walk the block at `start`, and queue where it can go next
+static translatedBlock walkBlock(const romImage& rom, uint16_t start, const quirkFlags& q,
+                                 std::vector<uint16_t>& next) {
+    translatedBlock block{ start, start, {} };
+    uint16_t addr = start;
+
+    while (rom.holds(addr) && block.addrs.size() < MAX_BLOCK_LENGTH) {
+        uint16_t opcode = rom.fetch(addr);
+        opKind kind = kindOf(opcode, q);
+
+        // F000 NNNN carries its operand in the next word
+        int length = q.xoChip && opcode == 0xF000 ? 4 : 2;
+        if (!rom.holds(addr, length))
+            break;
+
+        block.addrs.push_back(addr);
+        addr = static_cast<uint16_t>(addr + length);
+        block.end = addr;
+
+        if (kind == opKind::simple || kind == opKind::handler)
+            continue;
+
+        uint16_t nnn = opcode & 0x0FFF;
+        uint16_t after = block.end;
+        switch (opcode >> 12) {
+            case 0x1:
+                next.push_back(nnn);
+                break;
+            case 0x2:
+                next.push_back(nnn);
+                next.push_back(after);      // where the matching 00EE lands
+                break;
+            case 0x3: case 0x4: case 0x5: case 0x9: case 0xE:
+                if (kind == opKind::control) {
+                    next.push_back(after);
+                    next.push_back(static_cast<uint16_t>(after + 2));
+                    if (q.xoChip && rom.holds(after) && rom.fetch(after) == 0xF000)
+                        next.push_back(static_cast<uint16_t>(after + 4));
+                } else if ((opcode & 0xF00F) == 0x5002) {
+                    next.push_back(after);
+                }
+                break;
+            case 0xD: case 0xF:             // drawing, FX0A and the stores go on
+                next.push_back(after);
+                break;
+            default:                        // 00EE, BNNN, unknown opcodes
+                break;
+        }
+        return block;
+    }
+
+    // Cut at the length cap or the end of the image
+    next.push_back(addr);
+    return block;
+}
+
+static std::vector<translatedBlock> findBlocks(const romImage& rom, const quirkFlags& q) {
+    std::map<uint16_t, translatedBlock> blocks;
+    std::vector<uint16_t> pending{ 0x200 };
+
+    while (!pending.empty()) {
+        uint16_t start = pending.back();
+        pending.pop_back();
+        if (!rom.holds(start) || blocks.count(start))
+            continue;
+
+        translatedBlock block = walkBlock(rom, start, q, pending);
+        if (!block.addrs.empty())
+            blocks.emplace(start, std::move(block));
+    }
+
+    std::vector<translatedBlock> list;
+    for (auto& entry : blocks)
+        list.push_back(std::move(entry.second));
+    return list;
+}
+
+/* -------------------- CODE -------------------- */
+
+static std::string hex(unsigned value, int digits) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "0x%0*X", digits, value);
+    return buf;
+}
+
+static std::string reg(int r) {
+    return "c.V[" + hex(r, 1) + "]";
+}
+
+// Emits one block as a case of the switch in run(). PC isn't stored after
+// every instruction: `offset` is how far the instruction being translated
+// is past c.pc.
+class blockWriter {
+
+private:
+    std::ostream& out;
+    const romImage& rom;
+    const quirkFlags& q;
+    unsigned offset = 0;
+
+    void line(const std::string& code) { out << "                " << code << "\n"; }
+
+    void syncPc() {
+        if (offset)
+            line("c.pc += " + std::to_string(offset) + ";");
+        offset = 0;
+    }
+
+    // The core's handler for `opcode`, from the module's table of decoded
+    // ops. Handlers move PC themselves.
+    std::string handlerCall(uint16_t opcode) {
+        auto found = handlerIndex.find(opcode);
+        if (found == handlerIndex.end()) {
+            found = handlerIndex.emplace(opcode, handlers.size()).first;
+            handlers.push_back(opcode);
+        }
+        std::string op = "OPS[" + std::to_string(found->second) + "]";
+        return op + ".handler(c, " + op + ");";
+    }
+
+    std::string skipLength() const {
+        return q.xoChip ? "(c.fetch((c.pc + 2) & 0x0FFF) == 0xF000 ? 6 : 4)" : "4";
+    }
+
+    void skipIf(const std::string& condition) {
+        syncPc();
+        line("c.pc += (" + condition + ") ? " + skipLength() + " : 2;");
+    }
+
+    void simple(uint16_t opcode) {
+        int x = (opcode >> 8) & 0xF;
+        int y = (opcode >> 4) & 0xF;
+        std::string vx = reg(x), vy = reg(y), vf = reg(0xF);
+        std::string nn = hex(opcode & 0xFF, 2);
+
+        switch (opcode >> 12) {
+            case 0x6: line(vx + " = " + nn + ";"); break;
+            case 0x7: line(vx + " = static_cast<uint8_t>(" + vx + " + " + nn + ");"); break;
+            case 0xA: line("c.I = " + hex(opcode & 0x0FFF, 3) + ";"); break;
+            case 0xC: line(vx + " = c.nextRandom() & " + nn + ";"); break;
+
+            case 0x8: {
+                // Same statement order as the handlers, so X or Y = F works out the same
+                std::string source = reg(q.shiftUsesVY ? y : x);
+                switch (opcode & 0xF) {
+                    case 0x0: line(vx + " = " + vy + ";"); break;
+                    case 0x1: line(vx + " = " + vx + " | " + vy + ";"); break;
+                    case 0x2: line(vx + " = " + vx + " & " + vy + ";"); break;
+                    case 0x3: line(vx + " = " + vx + " ^ " + vy + ";"); break;
+                    case 0x4:
+                        line("{ unsigned sum = " + vx + " + " + vy + "; " + vf + " = sum > 0xFF; "
+                             + vx + " = static_cast<uint8_t>(sum); }");
+                        break;
+                    case 0x5:
+                        line(vf + " = " + vx + " >= " + vy + "; " + vx + " = static_cast<uint8_t>("
+                             + vx + " - " + vy + ");");
+                        break;
+                    case 0x6:
+                        line("{ uint8_t value = " + source + "; " + vf + " = value & 1; " + vx
+                             + " = value >> 1; }");
+                        break;
+                    case 0x7:
+                        line(vf + " = " + vy + " >= " + vx + "; " + vx + " = static_cast<uint8_t>("
+                             + vy + " - " + vx + ");");
+                        break;
+                    case 0xE:
+                        line("{ uint8_t value = " + source + "; " + vf + " = value >> 7; " + vx
+                             + " = static_cast<uint8_t>(value << 1); }");
+                        break;
+                    default:
+                        line("// ignored");
+                        break;
+                }
+                uint8_t n = opcode & 0xF;
+                if (q.logicResetsVF && n >= 0x1 && n <= 0x3)
+                    line(vf + " = 0;");
+                break;
+            }
+
+            case 0xF:
+                switch (opcode & 0xFF) {
+                    case 0x07: line(vx + " = c.delay_timer;"); break;
+                    case 0x15: line("c.delay_timer = " + vx + ";"); break;
+                    case 0x18: line("c.sound_timer = " + vx + ";"); break;
+                    case 0x1E:
+                        line("c.I = static_cast<uint16_t>(c.I + " + vx + ");");
+                        if (q.indexOverflowFlag)
+                            line(vf + " = c.I > 0x0FFF;");
+                        if (!q.xoChip)
+                            line("c.I &= 0x0FFF;");
+                        break;
+                    case 0x29:
+                        line("c.I = static_cast<uint16_t>(0x50 + (" + vx + " & 0x0F) * 5);");
+                        break;
+                }
+                break;
+        }
+        offset += 2;
+    }
+
+    void control(uint16_t addr, uint16_t opcode) {
+        int x = (opcode >> 8) & 0xF;
+        int y = (opcode >> 4) & 0xF;
+        uint16_t nnn = opcode & 0x0FFF;
+        std::string vx = reg(x), vy = reg(y);
+        std::string nn = hex(opcode & 0xFF, 2);
+
+        switch (opcode >> 12) {
+            case 0x0: // 00EE
+                syncPc();
+                line("if (c.sp == 0) " + handlerCall(opcode) + " else c.pc = c.stack[--c.sp];");
+                break;
+            case 0x1:
+                line("c.pc = " + hex(nnn, 3) + ";");
+                if (nnn == addr || nnn + 4 == addr)
+                    line("if (c.idleSkipping) c.checkIdleJump(" + hex(addr, 3) + ");");
+                break;
+            case 0x2:
+                syncPc();
+                line("if (c.sp == 16) " + handlerCall(opcode) + " else { c.stack[c.sp++] = "
+                     "static_cast<uint16_t>(c.pc + 2); c.pc = " + hex(nnn, 3) + "; }");
+                break;
+            case 0x3: skipIf(vx + " == " + nn); break;
+            case 0x4: skipIf(vx + " != " + nn); break;
+            case 0x5: skipIf(vx + " == " + vy); break;
+            case 0x9: skipIf(vx + " != " + vy); break;
+            case 0xB:
+                line("c.pc = static_cast<uint16_t>(" + hex(nnn, 3) + " + " + reg(q.jumpUsesVX ? x : 0) + ");");
+                break;
+            case 0xE: {
+                syncPc();
+                std::string pressed = (opcode & 0xFF) == 0x9E ? " != 0" : " == 0";
+                line("if (" + vx + " > 0xF) " + handlerCall(opcode));
+                line("else c.pc += (c.key[" + vx + "]" + pressed + ") ? " + skipLength() + " : 2;");
+                break;
+            }
+        }
+    }
+
+public:
+    // Opcodes run through the core's handlers, in table order
+    std::vector<uint16_t> handlers;
+    std::map<uint16_t, size_t> handlerIndex;
+
+    blockWriter(std::ostream& out, const romImage& rom, const quirkFlags& q) : out(out), rom(rom), q(q) {}
+
+    // Where `block` can go next, as far as is known ahead of time
+    struct exits {
+        std::vector<uint16_t> to;
+        bool exact = false;     // PC is always to[0] unless the core stopped
+        bool mayStop = false;   // the last instruction can stop the core
+    };
+
+    exits exitsOf(const translatedBlock& block) const {
+        exits e;
+        uint16_t last = block.addrs.back();
+        uint16_t opcode = rom.fetch(last);
+        uint16_t nnn = opcode & 0x0FFF;
+
+        switch (kindOf(opcode, q)) {
+            case opKind::simple:
+            case opKind::handler:
+                e.to = { block.end };
+                e.exact = true;
+                break;
+            case opKind::handlerEnd:
+                // Mostly on to the next instruction, but unknown opcodes
+                // fault and 00FD/0NNN don't
+                e.to = { block.end };
+                e.mayStop = true;
+                break;
+            case opKind::control:
+                switch (opcode >> 12) {
+                    case 0x1:
+                        e.to = { nnn };
+                        e.exact = true;
+                        e.mayStop = nnn == last || nnn + 4 == last;
+                        break;
+                    case 0x2:
+                        e.to = { nnn };
+                        e.exact = true;
+                        e.mayStop = true;
+                        break;
+                    case 0x3: case 0x4: case 0x5: case 0x9: case 0xE:
+                        e.to = { block.end, static_cast<uint16_t>(block.end + 2) };
+                        if (q.xoChip)
+                            e.to.push_back(static_cast<uint16_t>(block.end + 4));
+                        e.mayStop = (opcode >> 12) == 0xE;
+                        break;
+                    default:            // 00EE, BNNN
+                        e.mayStop = opcode == 0x00EE;
+                        break;
+                }
+                break;
+        }
+        return e;
+    }
+
+    // `target`: other blocks jump here. `starts`: every block.
+    void write(const translatedBlock& block, size_t index, bool target, const std::set<uint16_t>& starts) {
+        std::string name = hex(block.start, 3);
+        out << "            case " << name << ":" << (target ? " b" + name.substr(2) + ":" : "") << "\n";
+
+        char check[160];
+        std::snprintf(check, sizeof(check), "if (cycles - done < %zu || !c.nativeIntact(%zu, 0x%016llXull))",
+                      block.addrs.size(), index, static_cast<unsigned long long>(block.pages()));
+        line(check);
+        line("    return done;");
+        offset = 0;
+
+        bool ended = false;
+        for (uint16_t addr : block.addrs) {
+            uint16_t opcode = rom.fetch(addr);
+            out << "                // " << hex(addr, 3).substr(2) << ": " << hex(opcode, 4).substr(2) << "\n";
+
+            switch (kindOf(opcode, q)) {
+                case opKind::simple:
+                    simple(opcode);
+                    break;
+                case opKind::control:
+                    control(addr, opcode);
+                    ended = true;
+                    break;
+                case opKind::handler:
+                case opKind::handlerEnd:
+                    syncPc();
+                    line(handlerCall(opcode));
+                    ended = kindOf(opcode, q) == opKind::handlerEnd;
+                    break;
+            }
+        }
+        if (!ended)
+            syncPc();
+
+        line("done += " + std::to_string(block.addrs.size()) + ";");
+
+        // Straight on to the next block where it is known, through the
+        // switch otherwise
+        exits next = exitsOf(block);
+        if (next.mayStop)
+            line("if (c.stopped) return done;");
+        for (uint16_t to : next.to) {
+            if (!starts.count(to))
+                continue;
+            std::string label = "goto b" + hex(to, 3).substr(2) + ";";
+            line(next.exact ? label : "if (c.pc == " + hex(to, 3) + ") " + label);
+        }
+        if (!next.exact || !starts.count(next.to[0]))
+            line("break;");
+        out << "\n";
+    }
+};
+
+static void writeModule(std::ostream& out, const romImage& rom, quirkProfile profile,
+                        const std::string& name, const std::string& source) {
+    quirkFlags q = flagsOf(profile);
+    std::vector<translatedBlock> blocks = findBlocks(rom, q);
+
+    size_t instructions = 0;
+    for (const translatedBlock& block : blocks)
+        instructions += block.addrs.size();
+
+    out << "// Generated by chip8_aot from " << source << " (" << quirkProfileName(profile)
+        << " quirks): " << blocks.size() << " blocks, " << instructions << " instructions.\n"
+        << "// Do not edit; rerun chip8_aot instead.\n\n"
+        << "#include \"aot.hpp\"\n\n"
+        << "namespace {\n\n"
+        << "struct romTag {};\n\n"
+        << "// The image the blocks were translated from (code part only)\n"
+        << "const uint8_t IMAGE[] = {";
+
+    size_t imageSize = rom.end() - 0x200;
+    for (size_t i = 0; i < imageSize; ++i)
+        out << (i % 16 ? " " : "\n    ") << hex(rom.bytes[i], 2) << ",";
+    out << "\n};\n\n";
+
+    // Blocks other blocks jump straight to
+    std::ostringstream code;
+    blockWriter writer(code, rom, q);
+    std::set<uint16_t> starts, targets;
+    for (const translatedBlock& block : blocks)
+        starts.insert(block.start);
+    for (const translatedBlock& block : blocks) {
+        for (uint16_t to : writer.exitsOf(block).to) {
+            if (starts.count(to))
+                targets.insert(to);
+        }
+    }
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+        writer.write(blocks[i], i, targets.count(blocks[i].start) != 0, starts);
+
+    // The handlers' opcodes, decoded for the profile at registration
+    size_t handlerCount = std::max<size_t>(writer.handlers.size(), 1);
+    out << "const uint16_t OPCODES[" << handlerCount << "] = {";
+    for (size_t i = 0; i < writer.handlers.size(); ++i)
+        out << (i % 12 ? " " : "\n    ") << hex(writer.handlers[i], 4) << ",";
+    out << "\n};\n\n"
+        << "decodedOp OPS[" << handlerCount << "];\n\n"
+        << "} // namespace\n\n"
+        << "template <>\n"
+        << "struct aotCode<romTag> {\n\n"
+        << "    static void prepare() {\n"
+        << "        for (size_t i = 0; i < " << handlerCount << "; ++i)\n"
+        << "            OPS[i] = chip8::decode<" << quirkProfileName(profile) << "Quirks>(OPCODES[i]);\n"
+        << "    }\n\n"
+        << "    static uint64_t run(chip8& c, uint64_t cycles) {\n"
+        << "        uint64_t done = 0;\n"
+        << "        for (;;) {\n"
+        << "            switch (c.pc & 0x0FFF) {\n"
+        << code.str()
+        << "            default:\n"
+        << "                return done;\n"
+        << "            }\n"
+        << "        }\n"
+        << "    }\n"
+        << "};\n\n";
+
+    out << "namespace {\n\n"
+        << "const aotBlock BLOCKS[] = {\n";
+    for (const translatedBlock& block : blocks) {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "    { 0x%03X, %u, 0x%016llXull },\n", block.start,
+                      static_cast<unsigned>(block.end - block.start),
+                      static_cast<unsigned long long>(block.pages()));
+        out << buf;
+    }
+    out << "};\n\n";
+
+    char hash[32];
+    std::snprintf(hash, sizeof(hash), "0x%016llXull",
+                  static_cast<unsigned long long>(chip8::hashROM(rom.bytes.data(), rom.bytes.size())));
+
+    out << "const aotModule MODULE = {\n"
+        << "    \"" << name << "\", " << hash << ", quirkProfile::" << quirkProfileName(profile) << ",\n"
+        << "    IMAGE, sizeof(IMAGE), BLOCKS, sizeof(BLOCKS) / sizeof(BLOCKS[0]),\n"
+        << "    aotCode<romTag>::run\n"
+        << "};\n\n"
+        << "const bool REGISTERED = (aotCode<romTag>::prepare(), registerAotModule(MODULE));\n\n"
+        << "} // namespace\n";
+}
+
+/* -------------------- MAIN -------------------- */
+
+static void printUsage() {
+    std::cerr << "Usage: chip8_aot [--quirks legacy|chip8|schip|xochip] [--name id] [-o out.cpp] <rom>\n";
+}
+
+int main(int argc, char* argv[]) {
+    quirkProfile profile = quirkProfile::legacy;
+    std::string name;
+    std::string outputPath;
+    std::string romPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--quirks" && i + 1 < argc) {
+            if (!parseQuirkProfile(argv[++i], profile)) {
+                std::cerr << "Unknown quirk profile: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else {
+            romPath = arg;
+        }
+    }
+
+    if (romPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    romImage rom;
+    std::ifstream in(romPath, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open ROM: " << romPath << "\n";
+        return 1;
+    }
+    rom.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (rom.bytes.size() > MEMORY_SIZE - 0x200) {
+        std::cerr << "ROM too large to fit in memory: " << romPath << "\n";
+        return 1;
+    }
+
+    std::string source = romPath.substr(romPath.find_last_of("/\\") + 1);
+    if (name.empty())
+        name = source.substr(0, source.find('.'));
+
+    std::ostringstream code;
+    writeModule(code, rom, profile, name, source);
+
+    if (outputPath.empty()) {
+        std::cout << code.str();
+    } else {
+        std::ofstream out(outputPath, std::ios::binary);
+        if (!(out << code.str())) {
+            std::cerr << "Failed to write " << outputPath << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
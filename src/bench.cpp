@@ -0,0 +1,888 @@
+//
+// Created by patel on 2026-10-16.
+//
+// Dispatch benchmark: runs each workload with the plain fetch/decode
+// interpreter, the decode cache, basic blocks and (for ROMs translated with
+// chip8_aot into this binary) native code, and reports ns per
+// instruction, instructions per second and the spread across repeated
+// runs. --lockstep instead runs the interpreter side by side with the
+// decode cache, block mode and native code, and reports the first cycle
+// where their state differs. --lanes N runs N seeded copies of each
+// workload with random keys each frame, one by one and as a
+// lockstepBatch, and checks every lane ends up the same; the "own core"
+// column is the share the batch handed to each lane's own runFor().
+// --envs N steps an environmentBatch of N copies with random key actions,
+// on one thread and on all hardware threads, and checks both agree.
+// --random N runs N random ROMs per quirk profile through every dispatch
+// mode and a lockstepBatch kept on its columns, and checks them against
+// the interpreter and separate cores. --forks clones a running workload
+// out of an instancePool, runs 8 instructions in the clone and releases
+// it, and reports ns per fork.
+//
+// Workloads are the built-in synthetic ROMs (--synthetic) and any ROMs on
+// the command line. An input movie right after a ROM is replayed with it,
+// for the movie's whole length. --quirks picks the profile for the
+// workloads that follow it (the hi-res workload always runs as SUPER-CHIP).
+//
+
+#include "chip8.hpp"
+#include "environment.hpp"
+#include "instance_pool.hpp"
+#include "lockstep.hpp"
+#include "movie.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A ROM to run: either a file or one of the synthetic programs
+struct workload {
+    std::string name;
+    std::string path;                   // empty for synthetic ROMs
+    std::vector<uint8_t> program;
+    std::string moviePath;              // optional input replay
+    quirkProfile quirks = quirkProfile::legacy;
+    bool ownQuirks = false;             // needs its own profile, --quirks doesn't apply
+};
+
+struct benchRun {
+    std::string workloadName;
+    dispatchMode mode = dispatchMode::interpreter;
+    uint64_t cycles = 0;
+    std::vector<double> nsPerInstr;     // one sample per repeat, sorted
+
+    uint64_t fbHash = 0;
+    uint16_t pc = 0;
+    uint8_t V[16] = {};
+    bool matches = true;                // same end state as the interpreter
+};
+
+/* -------------------- SYNTHETIC ROMS -------------------- */
+
+// Each one is an endless loop that stresses one part of the core
+static std::vector<workload> syntheticWorkloads() {
+    std::vector<workload> list;
+
+    // 8XYn arithmetic and logic
+    list.push_back({ "alu", "", {
+            0x60, 0x01,     // 200: V0 = 1
+            0x61, 0x03,     // 202: V1 = 3
+            0x80, 0x14,     // 204: V0 += V1
+            0x81, 0x02,     // 206: V1 &= V0
+            0x80, 0x13,     // 208: V0 ^= V1
+            0x81, 0x05,     // 20A: V1 -= V0
+            0x80, 0x16,     // 20C: V0 >>= 1
+            0x81, 0x01,     // 20E: V1 |= V0
+            0x80, 0x1E,     // 210: V0 <<= 1
+            0x80, 0x17,     // 212: V0 = V1 - V0
+            0x12, 0x04,     // 214: jump 204
+    }, "" });
+
+    // Nested 2NNN / 00EE chains
+    list.push_back({ "call", "", {
+            0x22, 0x06,     // 200: call 206
+            0x12, 0x00,     // 202: jump 200
+            0x00, 0x00,     // 204: (unused)
+            0x22, 0x0A,     // 206: call 20A
+            0x00, 0xEE,     // 208: return
+            0x22, 0x0E,     // 20A: call 20E
+            0x00, 0xEE,     // 20C: return
+            0x70, 0x01,     // 20E: V0 += 1
+            0x00, 0xEE,     // 210: return
+    }, "" });
+
+    // The same through 0NEE, which every profile runs as 00EE
+    list.push_back({ "call-alias", "", {
+            0x22, 0x06,     // 200: call 206
+            0x12, 0x00,     // 202: jump 200
+            0x00, 0x00,     // 204: (unused)
+            0x70, 0x01,     // 206: V0 += 1
+            0x0B, 0xEE,     // 208: return (as 0BEE)
+            0x71, 0x01,     // 20A: V1 += 1, only if the return was missed
+            0x05, 0xEE,     // 20C: return (as 05EE)
+    }, "" });
+
+    // 15-row DXYN sprites walking across the screen, wrapping both ways
+    list.push_back({ "sprite", "", {
+            0xA0, 0x50,     // 200: I = 050 (font)
+            0xD0, 0x1F,     // 202: draw 15 rows at V0, V1
+            0x70, 0x07,     // 204: V0 += 7
+            0x71, 0x03,     // 206: V1 += 3
+            0x12, 0x02,     // 208: jump 202
+    }, "" });
+
+    // FX65 / FX55 copies of all sixteen registers
+    list.push_back({ "memcpy", "", {
+            0xA3, 0x00,     // 200: I = 300
+            0xFF, 0x65,     // 202: load V0..VF
+            0xA4, 0x00,     // 204: I = 400
+            0xFF, 0x55,     // 206: store V0..VF
+            0x70, 0x01,     // 208: V0 += 1
+            0x12, 0x00,     // 20A: jump 200
+    }, "" });
+
+    // SUPER-CHIP hi-res: 16 × 16 DXY0 sprites plus row and column scrolls
+    list.push_back({ "hires", "", {
+            0x00, 0xFF,     // 200: hi-res
+            0xA0, 0x50,     // 202: I = 050 (font)
+            0xD0, 0x10,     // 204: draw 16 × 16 at V0, V1
+            0x70, 0x0B,     // 206: V0 += 11
+            0x71, 0x05,     // 208: V1 += 5
+            0x00, 0xC1,     // 20A: scroll down 1
+            0x00, 0xFB,     // 20C: scroll right 4
+            0x12, 0x04,     // 20E: jump 204
+    }, "", quirkProfile::schip, true });
+
+    // Random and key-driven skips: lanes of a batch split and meet again
+    list.push_back({ "branches", "", {
+            0xC0, 0x03,     // 200: V0 = random & 3
+            0x30, 0x00,     // 202: skip if V0 == 0
+            0x71, 0x01,     // 204: V1 += 1
+            0x30, 0x01,     // 206: skip if V0 == 1
+            0x72, 0x03,     // 208: V2 += 3
+            0x63, 0x05,     // 20A: V3 = 5
+            0xE3, 0x9E,     // 20C: skip if key V3 is down
+            0x81, 0x24,     // 20E: V1 += V2
+            0x12, 0x00,     // 210: jump 200
+    }, "" });
+
+    // XO-CHIP: the sprite workload drawn on both planes at once
+    list.push_back({ "planes", "", {
+            0xF3, 0x01,     // 200: select planes 1 and 2
+            0xA0, 0x50,     // 202: I = 050 (font; plane 2 reads the 15 bytes after plane 1's)
+            0xD0, 0x1F,     // 204: draw 15 rows at V0, V1
+            0x70, 0x07,     // 206: V0 += 7
+            0x71, 0x03,     // 208: V1 += 3
+            0x12, 0x04,     // 20A: jump 204
+    }, "", quirkProfile::xochip, true });
+
+    return list;
+}
+
+/* -------------------- RUNS -------------------- */
+
+static void loadWorkload(chip8& emulator, const workload& w) {
+    emulator.setQuirks(w.quirks);
+    if (w.path.empty()) {
+        emulator.loadROM(w.program.data(), w.program.size());
+    } else {
+        emulator.loadROM(w.path);
+    }
+}
+
+// Whether chip8_aot code for the workload was built in
+static bool hasNativeCode(const workload& w) {
+    chip8 emulator;
+    emulator.setDispatchMode(dispatchMode::native);
+    loadWorkload(emulator, w);
+    return emulator.hasNativeCode();
+}
+
+static benchRun runWorkload(const workload& w, dispatchMode mode,
+                            uint64_t cycles, int repeats) {
+    benchRun result;
+    result.workloadName = w.name;
+    result.mode = mode;
+
+    inputMovie movie;
+    if (!w.moviePath.empty()) {
+        movie = inputMovie::load(w.moviePath);
+        cycles = movie.length;
+    }
+
+    for (int r = 0; r < repeats; ++r) {
+        chip8 emulator;
+        emulator.setDispatchMode(mode);
+        loadWorkload(emulator, w);
+
+        moviePlayer player(movie);
+        if (!w.moviePath.empty())
+            player.prepare(emulator);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t ran = w.moviePath.empty() ? emulator.runFor(cycles)
+                                           : player.runFor(emulator, cycles);
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        result.nsPerInstr.push_back(ran > 0 ? ns / ran : 0.0);
+        result.cycles = ran;
+
+        result.fbHash = emulator.displayHash();
+        result.pc = emulator.getPC();
+        std::memcpy(result.V, emulator.getRegisters(), sizeof(result.V));
+    }
+
+    std::sort(result.nsPerInstr.begin(), result.nsPerInstr.end());
+    return result;
+}
+
+static bool sameResult(const benchRun& a, const benchRun& b) {
+    return a.cycles == b.cycles && a.fbHash == b.fbHash && a.pc == b.pc
+        && std::memcmp(a.V, b.V, sizeof(a.V)) == 0;
+}
+
+/* -------------------- STATISTICS -------------------- */
+
+static double minNs(const benchRun& r) { return r.nsPerInstr.front(); }
+static double maxNs(const benchRun& r) { return r.nsPerInstr.back(); }
+
+static double medianNs(const benchRun& r) {
+    size_t n = r.nsPerInstr.size();
+    return (n % 2) ? r.nsPerInstr[n / 2]
+                   : (r.nsPerInstr[n / 2 - 1] + r.nsPerInstr[n / 2]) / 2.0;
+}
+
+static double stddevNs(const benchRun& r) {
+    double mean = 0.0;
+    for (double v : r.nsPerInstr)
+        mean += v;
+    mean /= r.nsPerInstr.size();
+
+    double sum = 0.0;
+    for (double v : r.nsPerInstr)
+        sum += (v - mean) * (v - mean);
+    return std::sqrt(sum / r.nsPerInstr.size());
+}
+
+// (max - min) / median, in percent
+static double spreadPercent(const benchRun& r) {
+    double median = medianNs(r);
+    return median > 0.0 ? 100.0 * (maxNs(r) - minNs(r)) / median : 0.0;
+}
+
+static double instrPerSecond(const benchRun& r) {
+    double median = medianNs(r);
+    return median > 0.0 ? 1e9 / median : 0.0;
+}
+
+static const char* modeName(dispatchMode mode) {
+    switch (mode) {
+        case dispatchMode::interpreter: return "interpreter";
+        case dispatchMode::cached:      return "cached";
+        case dispatchMode::block:       return "block";
+        case dispatchMode::native:      return "native";
+    }
+    return "?";
+}
+
+/* -------------------- OUTPUT -------------------- */
+
+static void printTable(const std::vector<benchRun>& runs) {
+    std::printf("%-24s %-12s %12s %10s %14s %8s %8s\n", "workload", "mode",
+                "cycles", "ns/instr", "instr/s", "spread", "speedup");
+
+    double base = 1.0;
+    for (const benchRun& r : runs) {
+        if (r.mode == dispatchMode::interpreter)
+            base = medianNs(r);
+
+        std::printf("%-24s %-12s %12llu %10.3f %14.0f %7.1f%% %7.2fx%s\n",
+                    r.workloadName.c_str(), modeName(r.mode),
+                    static_cast<unsigned long long>(r.cycles), medianNs(r),
+                    instrPerSecond(r), spreadPercent(r),
+                    medianNs(r) > 0.0 ? base / medianNs(r) : 0.0,
+                    r.matches ? "" : "  MISMATCH");
+    }
+}
+
+static void printCsv(const std::vector<benchRun>& runs) {
+    std::printf("workload,mode,cycles,runs,ns_min,ns_median,ns_max,ns_stddev,"
+                "instr_per_sec,spread_pct,fb_hash,match\n");
+
+    for (const benchRun& r : runs) {
+        std::printf("%s,%s,%llu,%zu,%.4f,%.4f,%.4f,%.4f,%.0f,%.2f,%016llX,%d\n",
+                    r.workloadName.c_str(), modeName(r.mode),
+                    static_cast<unsigned long long>(r.cycles), r.nsPerInstr.size(),
+                    minNs(r), medianNs(r), maxNs(r), stddevNs(r),
+                    instrPerSecond(r), spreadPercent(r),
+                    static_cast<unsigned long long>(r.fbHash), r.matches ? 1 : 0);
+    }
+}
+
+static void printJson(const std::vector<benchRun>& runs) {
+    std::printf("[\n");
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const benchRun& r = runs[i];
+        std::string name;
+        for (char c : r.workloadName) {
+            if (c == '"' || c == '\\')
+                name += '\\';
+            name += c;
+        }
+
+        std::printf("  {\"workload\": \"%s\", \"mode\": \"%s\", \"cycles\": %llu, \"runs\": %zu, "
+                    "\"ns_per_instr\": {\"min\": %.4f, \"median\": %.4f, \"max\": %.4f, \"stddev\": %.4f}, "
+                    "\"instr_per_sec\": %.0f, \"spread_pct\": %.2f, \"fb_hash\": \"%016llX\", \"match\": %s}%s\n",
+                    name.c_str(), modeName(r.mode),
+                    static_cast<unsigned long long>(r.cycles), r.nsPerInstr.size(),
+                    minNs(r), medianNs(r), maxNs(r), stddevNs(r),
+                    instrPerSecond(r), spreadPercent(r),
+                    static_cast<unsigned long long>(r.fbHash), r.matches ? "true" : "false",
+                    i + 1 < runs.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+/* -------------------- LOCKSTEP -------------------- */
+
+// Step the interpreter and `mode` by uneven slice sizes, so slices end
+// both on and off block boundaries, and compare full state after every
+// slice
+static bool lockstep(const workload& w, uint64_t cycles, dispatchMode mode) {
+    chip8 reference;
+    chip8 other;
+    reference.setDispatchMode(dispatchMode::interpreter);
+    other.setDispatchMode(mode);
+    loadWorkload(reference, w);
+    loadWorkload(other, w);
+
+    uint64_t done = 0;
+    uint64_t slice = 1;
+    while (done < cycles) {
+        uint64_t ranRef = reference.runFor(slice);
+        uint64_t ranOther = other.runFor(slice);
+
+        if (ranRef != ranOther || !reference.stateEquals(other)) {
+            std::printf("%-32s %s diverged within cycles %llu..%llu (pc %03X vs %03X)\n",
+                        w.name.c_str(), modeName(mode), static_cast<unsigned long long>(done),
+                        static_cast<unsigned long long>(done + slice),
+                        reference.getPC(), other.getPC());
+            return false;
+        }
+
+        done += ranRef;
+        if (ranRef < slice)
+            break; // both faulted at the same place
+
+        slice = slice % 97 + 1;
+    }
+
+    std::printf("%-32s %s lockstep ok for %llu cycles\n", w.name.c_str(), modeName(mode),
+                static_cast<unsigned long long>(done));
+    return true;
+}
+
+/* -------------------- LANES -------------------- */
+
+// Lane l's keys for a frame: mostly nothing, sometimes one key
+static uint16_t laneKeys(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    uint32_t pick = state % 24;
+    return pick < 16 ? static_cast<uint16_t>(1u << pick) : 0;
+}
+
+// Run `lanes` seeded copies of the workload frame by frame with random
+// keys, one chip8 each and as a lockstepBatch, and compare every lane
+static bool runLanes(const workload& w, size_t lanes, uint64_t cycles, int repeats) {
+    std::vector<double> scalarNs, batchNs;
+    bool same = true;
+    lockstepStats stats;
+    uint64_t ran = 0;
+
+    for (int r = 0; r < repeats; ++r) {
+        std::vector<std::unique_ptr<chip8>> cores;
+        lockstepBatch batch(lanes);
+        for (size_t l = 0; l < lanes; ++l) {
+            cores.push_back(std::make_unique<chip8>());
+            loadWorkload(*cores.back(), w);
+            cores.back()->seed(l);
+            loadWorkload(batch.lane(l), w);
+            batch.lane(l).seed(l);
+        }
+
+        uint64_t keyState = 0x9E3779B97F4A7C15ull;
+        uint64_t done = 0;
+        double scalarTime = 0.0, batchTime = 0.0;
+        uint64_t scalarRan = 0, batchRan = 0;
+
+        while (done < cycles) {
+            uint64_t frame = std::min(cores[0]->cyclesUntilFrame(), cycles - done);
+            for (size_t l = 0; l < lanes; ++l) {
+                uint16_t keys = laneKeys(keyState);
+                cores[l]->setKeys(keys);
+                batch.setKeys(l, keys);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t l = 0; l < lanes; ++l)
+                scalarRan += cores[l]->runFor(frame);
+            auto middle = std::chrono::steady_clock::now();
+            batchRan += batch.runFor(frame);
+            auto end = std::chrono::steady_clock::now();
+
+            scalarTime += std::chrono::duration<double, std::nano>(middle - start).count();
+            batchTime += std::chrono::duration<double, std::nano>(end - middle).count();
+            done += frame;
+        }
+
+        same &= scalarRan == batchRan;
+        for (size_t l = 0; l < lanes; ++l)
+            same &= cores[l]->stateEquals(batch.getLane(l));
+
+        scalarNs.push_back(scalarRan ? scalarTime / scalarRan : 0.0);
+        batchNs.push_back(batchRan ? batchTime / batchRan : 0.0);
+        stats = batch.stats();
+        ran = batchRan;
+    }
+
+    std::sort(scalarNs.begin(), scalarNs.end());
+    std::sort(batchNs.begin(), batchNs.end());
+    double scalar = scalarNs[scalarNs.size() / 2];
+    double lockstep = batchNs[batchNs.size() / 2];
+
+    std::printf("%-24s %6zu %12llu %10.3f %10.3f %7.2fx %9.1f %8.1f%% %8.1f%%%s\n",
+                w.name.c_str(), lanes, static_cast<unsigned long long>(ran), scalar, lockstep,
+                lockstep > 0.0 ? scalar / lockstep : 0.0, stats.occupancy(),
+                stats.laneSteps ? 100.0 * stats.fallbackSteps / stats.laneSteps : 0.0,
+                ran ? 100.0 * stats.scalarSteps / ran : 0.0, same ? "" : "  MISMATCH");
+    return same;
+}
+
+/* -------------------- RANDOM ROMS -------------------- */
+
+// A random ROM of real-looking instructions, weighted toward what fast
+// paths get wrong: VF as an operand, 0NNN aliases, jumps and calls that
+// stay inside the ROM, and I near the program
+static std::vector<uint8_t> randomRom(uint64_t& state) {
+    auto next = [&state](uint32_t range) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<uint32_t>(state % range);
+    };
+
+    size_t words = 32 + next(96);
+    std::vector<uint8_t> rom;
+    for (size_t i = 0; i < words; ++i) {
+        uint16_t family = next(16);
+        uint16_t x = next(4) == 0 ? 0xF : next(16);
+        uint16_t y = next(4) == 0 ? 0xF : next(16);
+        uint16_t low = next(256);
+        uint16_t target = static_cast<uint16_t>(0x200 + 2 * next(static_cast<uint32_t>(words)));
+        uint16_t opcode;
+
+        switch (family) {
+            case 0x0: {
+                static const uint16_t ZERO[] = { 0x00E0, 0x00EE, 0x0BEE, 0x05E0, 0x00C3, 0x00FB,
+                                                 0x00FC, 0x00FE, 0x00FF };
+                opcode = ZERO[next(sizeof(ZERO) / sizeof(ZERO[0]))];
+                break;
+            }
+            case 0x1: case 0x2: case 0xB:
+                opcode = static_cast<uint16_t>(family << 12 | target);
+                break;
+            case 0x5: case 0x8: case 0x9:
+                opcode = static_cast<uint16_t>(family << 12 | x << 8 | y << 4 | next(16));
+                break;
+            case 0xA:
+                opcode = static_cast<uint16_t>(0xA000 | (next(2) ? 0x200 + next(0x200) : 0x50 + next(80)));
+                break;
+            case 0xD:
+                opcode = static_cast<uint16_t>(0xD000 | x << 8 | y << 4 | next(16));
+                break;
+            case 0xF: {
+                static const uint8_t FX[] = { 0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x30, 0x33,
+                                              0x55, 0x65, 0x75, 0x85, 0x01, 0x02, 0x3A };
+                opcode = static_cast<uint16_t>(0xF000 | x << 8 | FX[next(sizeof(FX))]);
+                break;
+            }
+            default:
+                opcode = static_cast<uint16_t>(family << 12 | x << 8 | low);
+                break;
+        }
+        rom.push_back(static_cast<uint8_t>(opcode >> 8));
+        rom.push_back(static_cast<uint8_t>(opcode));
+    }
+    return rom;
+}
+
+// Run a random ROM on every dispatch mode and as a lockstepBatch of
+// seeded lanes with random keys, frame by frame, and name the first path
+// that ends up somewhere else than the interpreter (or separate cores)
+static const char* checkRandomRom(const std::vector<uint8_t>& rom, quirkProfile quirks, uint64_t cycles) {
+    const size_t LANES = 8;
+    const dispatchMode MODES[] = { dispatchMode::cached, dispatchMode::block };
+
+    auto setUp = [&](chip8& c, uint64_t seed) {
+        c.setQuirks(quirks);
+        c.loadROM(rom.data(), rom.size());
+        c.seed(seed);
+    };
+
+    chip8 reference;
+    reference.setDispatchMode(dispatchMode::interpreter);
+    setUp(reference, 0);
+    std::vector<std::unique_ptr<chip8>> others;
+    for (dispatchMode mode : MODES) {
+        others.push_back(std::make_unique<chip8>());
+        others.back()->setDispatchMode(mode);
+        setUp(*others.back(), 0);
+    }
+
+    std::vector<std::unique_ptr<chip8>> cores;
+    lockstepBatch batch(LANES);
+    batch.setAdaptive(false);
+    for (size_t l = 0; l < LANES; ++l) {
+        cores.push_back(std::make_unique<chip8>());
+        setUp(*cores.back(), l);
+        setUp(batch.lane(l), l);
+    }
+
+    uint64_t keyState = 0x9E3779B97F4A7C15ull;
+    uint64_t done = 0;
+    while (done < cycles) {
+        uint64_t frame = std::min(reference.cyclesUntilFrame(), cycles - done);
+        uint16_t keys = laneKeys(keyState);
+        reference.setKeys(keys);
+        reference.runFor(frame);
+        for (auto& other : others) {
+            other->setKeys(keys);
+            other->runFor(frame);
+        }
+        for (size_t l = 0; l < LANES; ++l) {
+            uint16_t laneKey = laneKeys(keyState);
+            cores[l]->setKeys(laneKey);
+            cores[l]->runFor(frame);
+            batch.setKeys(l, laneKey);
+        }
+        batch.runFor(frame);
+        done += frame;
+    }
+
+    for (size_t m = 0; m < others.size(); ++m) {
+        if (!reference.stateEquals(*others[m]))
+            return modeName(MODES[m]);
+    }
+    for (size_t l = 0; l < LANES; ++l) {
+        if (!cores[l]->stateEquals(batch.getLane(l)))
+            return "lockstep";
+    }
+    return nullptr;
+}
+
+// `roms` random ROMs on each quirk profile; prints the ones that disagree
+static bool runRandom(size_t roms, uint64_t cycles) {
+    const quirkProfile PROFILES[] = { quirkProfile::legacy, quirkProfile::chip8,
+                                      quirkProfile::schip, quirkProfile::xochip };
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    size_t failures = 0;
+
+    for (quirkProfile quirks : PROFILES) {
+        size_t bad = 0;
+        for (size_t r = 0; r < roms; ++r) {
+            std::vector<uint8_t> rom = randomRom(state);
+            const char* path = checkRandomRom(rom, quirks, cycles);
+            if (!path)
+                continue;
+
+            if (++bad <= 3) {
+                std::printf("%-8s %-11s differs on:", quirkProfileName(quirks), path);
+                for (size_t i = 0; i < rom.size(); i += 2)
+                    std::printf(" %02X%02X", rom[i], rom[i + 1]);
+                std::printf("\n");
+            }
+        }
+        std::printf("%-8s %zu random ROMs, %zu mismatched\n", quirkProfileName(quirks), roms, bad);
+        failures += bad;
+    }
+    return failures == 0;
+}
+
+/* -------------------- FORKS -------------------- */
+
+// Fork a running workload from an instancePool over and over, run a few
+// instructions in the fork and hand it back: ns per fork, and whether
+// every fork ran exactly like the original would have
+static bool runForks(const workload& w, uint64_t cycles, int repeats) {
+    const uint64_t FORK_CYCLES = 8;
+
+    chip8 origin;
+    loadWorkload(origin, w);
+    origin.runFor(origin.getCpuHz());   // a second in, so memory and code are warm
+
+    chip8 expected;
+    expected.copyFrom(origin);
+    expected.runFor(FORK_CYCLES);
+
+    instancePool pool;
+    uint64_t forks = std::max<uint64_t>(1, cycles / FORK_CYCLES);
+    std::vector<double> ns;
+    bool same = true;
+
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t f = 0; f < forks; ++f) {
+            chip8* fork = pool.clone(origin);
+            fork->runFor(FORK_CYCLES);
+            pool.release(fork);
+        }
+        auto end = std::chrono::steady_clock::now();
+        ns.push_back(std::chrono::duration<double, std::nano>(end - start).count() / forks);
+
+        // The last fork is back on the free list, untouched since
+        chip8* check = pool.clone(origin);
+        check->runFor(FORK_CYCLES);
+        same &= check->stateEquals(expected);
+        pool.release(check);
+    }
+
+    std::sort(ns.begin(), ns.end());
+    std::printf("%-24s %10llu %12.1f %12.1f%s\n", w.name.c_str(), static_cast<unsigned long long>(forks),
+                ns.front(), ns[ns.size() / 2], same ? "" : "  MISMATCH");
+    return same;
+}
+
+/* -------------------- ENVIRONMENTS -------------------- */
+
+struct environmentRun {
+    double framesPerSecond = 0.0;   // environment frames, median of the repeats
+    uint64_t frames = 0;
+    uint64_t hash = 0;              // over every observation, reward and done flag
+};
+
+static uint64_t hashBytes(uint64_t h, const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ p[i]) * 0x100000001B3ull;
+    return h;
+}
+
+// Step `count` environments of the workload with random key actions on a
+// pool of `threads`, for about as many instructions as the other modes run
+static environmentRun stepEnvironments(const workload& w, size_t count, unsigned threads,
+                                       uint64_t cycles, int repeats) {
+    chip8 prototype;
+    loadWorkload(prototype, w);
+
+    environmentConfig config;
+    config.maxFrames = 3600;        // a minute per episode, so resets are exercised too
+
+    uint64_t frameCycles = std::max<uint64_t>(1, prototype.getCpuHz() / 60);
+    uint64_t steps = std::max<uint64_t>(1, cycles / (frameCycles * config.frameSkip * count));
+
+    threadPool pool(threads);
+    environmentBatch batch(prototype, count, config, pool);
+    std::vector<uint8_t> observations(count * batch.observationSize());
+    std::vector<uint16_t> actions(count);
+    std::vector<float> rewards(count);
+    std::vector<uint8_t> dones(count);
+
+    environmentRun run;
+    std::vector<double> rates;
+    for (int r = 0; r < repeats; ++r) {
+        batch.reset(0, observations.data());
+        uint64_t keyState = 0x9E3779B97F4A7C15ull;
+        uint64_t hash = 0xCBF29CE484222325ull;
+        double seconds = 0.0;
+
+        for (uint64_t s = 0; s < steps; ++s) {
+            for (uint16_t& a : actions)
+                a = laneKeys(keyState);
+
+            auto start = std::chrono::steady_clock::now();
+            batch.step(actions.data(), observations.data(), rewards.data(), dones.data());
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            hash = hashBytes(hash, observations.data(), observations.size());
+            hash = hashBytes(hash, rewards.data(), rewards.size() * sizeof(float));
+            hash = hashBytes(hash, dones.data(), dones.size());
+        }
+
+        run.frames = steps * config.frameSkip * count;
+        run.hash = hash;
+        rates.push_back(seconds > 0.0 ? run.frames / seconds : 0.0);
+    }
+
+    std::sort(rates.begin(), rates.end());
+    run.framesPerSecond = rates[rates.size() / 2];
+    return run;
+}
+
+// The same environments on one thread and on every hardware thread (at
+// least two, so the split is checked even on one core): frames per
+// second for each, and whether they agree
+static bool runEnvironments(const workload& w, size_t count, uint64_t cycles, int repeats) {
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+    environmentRun one = stepEnvironments(w, count, 1, cycles, repeats);
+    environmentRun all = stepEnvironments(w, count, threads, cycles, repeats);
+    bool same = one.hash == all.hash;
+
+    std::printf("%-24s %6zu %12llu %12.2f %8u %12.2f%s\n",
+                w.name.c_str(), count, static_cast<unsigned long long>(all.frames),
+                one.framesPerSecond / 1e6, threads, all.framesPerSecond / 1e6,
+                same ? "" : "  MISMATCH");
+    return same;
+}
+
+static void printUsage() {
+    std::cerr << "Usage: chip8_bench [--cycles N] [--repeat R] [--format table|csv|json] [--lockstep]\n"
+              << "                   [--lanes N] [--envs N] [--forks] [--random N]\n"
+              << "                   [--quirks legacy|chip8|schip|xochip] [--synthetic]\n"
+              << "                   [<rom> [movie]]...\n";
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t cycles = 20000000;
+    int repeats = 5;
+    bool lockstepMode = false;
+    size_t lanes = 0;
+    size_t envs = 0;
+    bool forkMode = false;
+    size_t randomRoms = 0;
+    std::string format = "table";
+    quirkProfile quirks = quirkProfile::legacy;
+    std::vector<workload> workloads;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+
+            if (arg == "--cycles" && i + 1 < argc) {
+                cycles = std::stoull(argv[++i]);
+            } else if (arg == "--repeat" && i + 1 < argc) {
+                repeats = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--lockstep") {
+                lockstepMode = true;
+            } else if (arg == "--lanes" && i + 1 < argc) {
+                lanes = std::stoul(argv[++i]);
+                if (lanes == 0 || lanes > lockstepBatch::LANES) {
+                    std::cerr << "--lanes takes 1 to " << lockstepBatch::LANES << "\n";
+                    return 1;
+                }
+            } else if (arg == "--random" && i + 1 < argc) {
+                randomRoms = std::stoul(argv[++i]);
+            } else if (arg == "--forks") {
+                forkMode = true;
+            } else if (arg == "--envs" && i + 1 < argc) {
+                envs = std::stoul(argv[++i]);
+                if (envs == 0) {
+                    std::cerr << "--envs takes at least 1\n";
+                    return 1;
+                }
+            } else if (arg == "--synthetic") {
+                for (workload w : syntheticWorkloads()) {
+                    if (!w.ownQuirks)
+                        w.quirks = quirks;
+                    workloads.push_back(w);
+                }
+            } else if (arg == "--quirks" && i + 1 < argc) {
+                if (!parseQuirkProfile(argv[++i], quirks)) {
+                    std::cerr << "Unknown quirk profile: " << argv[i] << "\n";
+                    return 1;
+                }
+            } else if (arg == "--format" && i + 1 < argc) {
+                format = argv[++i];
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else if (!workloads.empty() && !workloads.back().path.empty()
+                       && workloads.back().moviePath.empty() && inputMovie::isMovie(arg)) {
+                workloads.back().moviePath = arg;
+                workloads.back().name += "+" + arg;
+            } else {
+                workloads.push_back({ arg, arg, {}, "", quirks, false });
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    if (randomRoms > 0) {
+        // Each ROM runs for a handful of frames; it has usually faulted
+        // or settled into a loop by then
+        try {
+            return runRandom(randomRoms, std::min<uint64_t>(cycles, 6000)) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (workloads.empty() || (format != "table" && format != "csv" && format != "json")) {
+        printUsage();
+        return 1;
+    }
+
+    bool mismatch = false;
+    std::vector<benchRun> runs;
+
+    if (forkMode) {
+        // ns per fork: clone, run 8 instructions, release
+        std::printf("%-24s %10s %12s %12s\n", "workload", "forks", "min ns", "median ns");
+    } else if (envs > 0) {
+        // Million environment frames per second, one thread vs all of them
+        std::printf("%-24s %6s %12s %12s %8s %12s\n", "workload", "envs", "frames",
+                    "1 thread", "threads", "all threads");
+    } else if (lanes > 0 && !lockstepMode) {
+        // ns per lane instruction, one core per lane vs the batch
+        std::printf("%-24s %6s %12s %10s %10s %8s %9s %9s %9s\n", "workload", "lanes", "cycles",
+                    "scalar", "lockstep", "speedup", "occupancy", "fallback", "own core");
+    }
+
+    for (const workload& w : workloads) {
+        try {
+            if (forkMode) {
+                mismatch |= !runForks(w, cycles, repeats);
+                continue;
+            }
+            if (envs > 0) {
+                mismatch |= !runEnvironments(w, envs, cycles, repeats);
+                continue;
+            }
+            if (lanes > 0 && !lockstepMode) {
+                mismatch |= !runLanes(w, lanes, cycles, repeats);
+                continue;
+            }
+            if (lockstepMode) {
+                mismatch |= !lockstep(w, cycles, dispatchMode::cached);
+                mismatch |= !lockstep(w, cycles, dispatchMode::block);
+                if (hasNativeCode(w))
+                    mismatch |= !lockstep(w, cycles, dispatchMode::native);
+                continue;
+            }
+
+            benchRun interp = runWorkload(w, dispatchMode::interpreter, cycles, repeats);
+            benchRun cached = runWorkload(w, dispatchMode::cached, cycles, repeats);
+            benchRun block = runWorkload(w, dispatchMode::block, cycles, repeats);
+
+            // Every path must end up in the same place
+            cached.matches = sameResult(interp, cached);
+            block.matches = sameResult(interp, block);
+            mismatch |= !cached.matches || !block.matches;
+
+            runs.push_back(interp);
+            runs.push_back(cached);
+            runs.push_back(block);
+
+            if (hasNativeCode(w)) {
+                benchRun native = runWorkload(w, dispatchMode::native, cycles, repeats);
+                native.matches = sameResult(interp, native);
+                mismatch |= !native.matches;
+                runs.push_back(native);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (format == "csv") {
+        printCsv(runs);
+    } else if (format == "json") {
+        printJson(runs);
+    } else if (!lockstepMode && lanes == 0 && envs == 0 && !forkMode) {
+        printTable(runs);
+    }
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "capture.hpp"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+static void putBytes(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i)
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+static void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+static void xorBytes(captureFrame& f, const uint8_t* delta) {
+    uint64_t* words = &f.rows[0][0][0];
+    for (size_t w = 0; w < frameCapture::FRAME_BYTES / 8; ++w)
+        for (int b = 0; b < 8; ++b)
+            words[w] ^= static_cast<uint64_t>(*delta++) << (8 * b);
+}
+
+/* -------------------- CAPTURE -------------------- */
+
+frameCapture::frameCapture(size_t queueFrames, bool waitWhenFull)
+        : slots(queueFrames ? queueFrames : 1), waitWhenFull(waitWhenFull) {}
+
+frameCapture::~frameCapture() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // Nothing to report to from a destructor; call close() to see it
+    }
+}
+
+void frameCapture::open(const std::string& filename, const chip8& emulator) {
+    close();
+
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open capture: " + filename);
+    }
+    path = filename;
+
+    std::vector<uint8_t> header;
+    header.insert(header.end(), { 'C', '8', 'F', 'C' });
+    putBytes(header, VERSION, 2);
+    putBytes(header, static_cast<uint64_t>(emulator.getQuirks()), 2);
+    putBytes(header, emulator.getROMHash(), 8);
+    putBytes(header, emulator.getCpuHz(), 4);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    frames = 0;
+    droppedFrames = 0;
+    head = 0;
+    count = 0;
+    closing = false;
+    full = false;
+    std::memset(previous, 0, sizeof(previous));
+    previousHires = false;
+    lastWritten = 0;
+    failed = false;
+
+    // Frame 0 is whatever is on screen now (nothing is stored if it's blank)
+    captureFrame& first = slots[0];
+    first.frame = 0;
+    first.hires = emulator.isHires();
+    std::memcpy(first.rows[0], emulator.getPlaneRows(0), sizeof(first.rows[0]));
+    std::memcpy(first.rows[1], emulator.getPlaneRows(1), sizeof(first.rows[1]));
+    count = 1;
+
+    writer = std::thread(&frameCapture::writerLoop, this);
+}
+
+void frameCapture::frame(const chip8& emulator) {
+    ++frames;
+    if (!emulator.shouldDraw() || !writer.joinable())
+        return;
+
+    std::unique_lock<std::mutex> guard(lock);
+    if (waitWhenFull && count == slots.size()) {
+        full = true;
+        space.wait(guard, [this] { return !full; });
+    } else if (count == slots.size()) {
+        ++droppedFrames;
+        return;
+    }
+
+    captureFrame& f = slots[(head + count) % slots.size()];
+    f.frame = frames;
+    f.hires = emulator.isHires();
+    std::memcpy(f.rows[0], emulator.getPlaneRows(0), sizeof(f.rows[0]));
+    std::memcpy(f.rows[1], emulator.getPlaneRows(1), sizeof(f.rows[1]));
+    if (count++ == 0)
+        wake.notify_one();
+}
+
+void frameCapture::close() {
+    if (!writer.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    record.clear();
+    putVarint(record, frames - lastWritten);
+    record.push_back(0x80);
+    file.write(reinterpret_cast<const char*>(record.data()), record.size());
+    file.close();
+
+    if (failed || file.fail()) {
+        throw std::runtime_error("Failed to write capture: " + path);
+    }
+}
+
+void frameCapture::writerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        wake.wait(guard, [this] { return count > 0 || closing; });
+        if (count == 0)
+            return; // closing, and everything is written
+
+        const captureFrame& f = slots[head];
+        guard.unlock();
+        writeFrame(f);
+        guard.lock();
+
+        head = (head + 1) % slots.size();
+        --count;
+
+        // Let a waiting emulator go once there's room for a run of frames,
+        // not slot by slot
+        if (full && count <= slots.size() / 2) {
+            full = false;
+            space.notify_one();
+        }
+    }
+}
+
+void frameCapture::writeFrame(const captureFrame& f) {
+    // The delta as the file stores it: every word, plane by plane, row
+    // by row, least significant byte first
+    const uint64_t* words = &f.rows[0][0][0];
+    uint64_t* before = &previous[0][0][0];
+    uint8_t delta[FRAME_BYTES];
+
+    bool changed = f.hires != previousHires;
+    for (size_t w = 0; w < FRAME_BYTES / 8; ++w) {
+        uint64_t d = words[w] ^ before[w];
+        changed |= d != 0;
+        for (int b = 0; b < 8; ++b)
+            delta[8 * w + b] = static_cast<uint8_t>(d >> (8 * b));
+    }
+    if (!changed)
+        return; // drawn over with the same pixels
+
+    // Zero runs and literal runs. A literal run ends at the first two
+    // zero bytes in a row; a lone zero is cheaper kept in the run.
+    payload.clear();
+    size_t i = 0;
+    while (i < FRAME_BYTES) {
+        size_t zeros = i;
+        while (zeros < FRAME_BYTES && delta[zeros] == 0)
+            ++zeros;
+
+        size_t end = zeros;
+        while (end < FRAME_BYTES && (delta[end] != 0 || (end + 1 < FRAME_BYTES && delta[end + 1] != 0)))
+            ++end;
+
+        putVarint(payload, zeros - i);
+        putVarint(payload, end - zeros);
+        payload.insert(payload.end(), delta + zeros, delta + end);
+        i = end;
+    }
+
+    record.clear();
+    putVarint(record, f.frame - lastWritten);
+    record.push_back(f.hires ? 0x01 : 0x00);
+    putVarint(record, payload.size());
+    record.insert(record.end(), payload.begin(), payload.end());
+
+    if (!file.write(reinterpret_cast<const char*>(record.data()), record.size()))
+        failed = true;
+
+    std::memcpy(previous, f.rows, FRAME_BYTES);
+    previousHires = f.hires;
+    lastWritten = f.frame;
+}
+
+/* -------------------- READER -------------------- */
+
+// Bounds-checked cursor over a capture; false once it runs off the end
+struct captureCursor {
+    const std::vector<uint8_t>& data;
+    size_t pos;
+
+    bool bytes(int count, uint64_t& v) {
+        if (pos + count > data.size())
+            return false;
+        v = 0;
+        for (int i = 0; i < count; ++i)
+            v |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+        return true;
+    }
+
+    bool varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= data.size())
+                return false;
+            uint8_t b = data[pos++];
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        throw std::runtime_error("Bad number in capture");
+    }
+};
+
+captureReader::captureReader(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open capture: " + filename);
+    }
+
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (data.size() < 4 || std::memcmp(data.data(), "C8FC", 4) != 0) {
+        throw std::runtime_error("Not a frame capture: " + filename);
+    }
+
+    captureCursor in{ data, 4 };
+    uint64_t v, quirkValue, hash, hz;
+    if (!in.bytes(2, v) || !in.bytes(2, quirkValue) || !in.bytes(8, hash) || !in.bytes(4, hz)) {
+        throw std::runtime_error("Frame capture is truncated: " + filename);
+    }
+    if (v != frameCapture::VERSION) {
+        throw std::runtime_error("Unsupported frame capture version: " + filename);
+    }
+    if (quirkValue > static_cast<uint64_t>(quirkProfile::xochip)) {
+        throw std::runtime_error("Unknown quirk profile in frame capture: " + filename);
+    }
+
+    version = static_cast<uint16_t>(v);
+    quirks = static_cast<quirkProfile>(quirkValue);
+    romHash = hash;
+    cpuHz = static_cast<uint32_t>(hz);
+    pos = in.pos;
+}
+
+bool captureReader::next(captureFrame& out) {
+    if (ended)
+        return false;
+
+    captureCursor in{ data, pos };
+    uint64_t delta, flags, size;
+    if (!in.varint(delta) || !in.bytes(1, flags)) {
+        endFrame = current.frame; // cut short: end on the last whole frame
+        return false;
+    }
+    if (flags & 0x80) {
+        ended = true;
+        endFrame = current.frame + delta;
+        return false;
+    }
+    if (!in.varint(size) || size > data.size() - in.pos) {
+        endFrame = current.frame;
+        return false;
+    }
+
+    // Undo the runs into a delta, then apply it
+    uint8_t bytes[frameCapture::FRAME_BYTES] = {};
+    size_t end = in.pos + size;
+    size_t at = 0;
+    while (in.pos < end) {
+        uint64_t zeros, literals;
+        if (!in.varint(zeros) || !in.varint(literals) || in.pos + literals > end ||
+            at + zeros + literals > frameCapture::FRAME_BYTES) {
+            throw std::runtime_error("Corrupt frame in capture");
+        }
+        at += zeros;
+        std::memcpy(bytes + at, data.data() + in.pos, literals);
+        at += literals;
+        in.pos += literals;
+    }
+
+    xorBytes(current, bytes);
+    current.frame += delta;
+    current.hires = flags & 0x01;
+    pos = in.pos;
+
+    out = current;
+    return true;
+}
@@ -0,0 +1,148 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_CAPTURE_HPP
+#define CHIP8_EMULATOR_CAPTURE_HPP
+
+#include "chip8.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One captured display: both bitplanes as chip8 keeps them (see
+// chip8::getPlaneRows), shown from 60 Hz frame `frame` on
+struct captureFrame {
+    uint64_t frame = 0;
+    bool hires = false;
+    uint64_t rows[2][64][2] = {};
+
+    int width() const { return hires ? 128 : 64; }
+    int height() const { return hires ? 64 : 32; }
+
+    // Colour 0–3 of pixel (x, y) of the visible area
+    int pixel(int x, int y) const {
+        int shift = 63 - (x & 63);
+        return static_cast<int>((rows[0][y][x >> 6] >> shift & 1) | (rows[1][y][x >> 6] >> shift & 1) << 1);
+    }
+};
+
+/*
+    Frame capture: a video of a run, small enough to keep as a CI artifact.
+
+    Call frame() once per 60 Hz frame (after runFrame(), or a runFor()
+    that ended on a frame). If shouldDraw() is set, the display is copied
+    into a bounded queue and a writer thread stores it as an XOR delta
+    against the frame before, run-length encoded; frames where nothing
+    changed cost nothing. Emulation doesn't wait on the disk: when the
+    queue is full the frame is dropped (dropped() counts them) and the
+    next one is stored against the last frame that made it. Batch runs,
+    which have no frame deadline and outrun any writer, can ask to wait
+    for a free slot instead and lose nothing.
+
+    File format (little-endian):
+        "C8FC", u16 version, u16 quirk profile, u64 ROM hash, u32 cpu Hz
+        records:
+            LEB128 frames since the previous record (the first counts
+            from frame 0, a blank lo-res display), u8 flags
+            flags 0x01: hi-res; flags 0x80: end of the capture, nothing follows
+            LEB128 payload size, payload: the 2048 display bytes XORed
+            with the previous frame's, as pairs of LEB128 zero run,
+            LEB128 literal count + that many bytes, until all 2048 are
+            covered
+    A capture cut short (the process died) reads up to its last whole record.
+
+    Not thread-safe on the emulator side; one capture per emulator.
+*/
+class frameCapture {
+
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t FRAME_BYTES = sizeof(captureFrame::rows);
+
+private:
+    std::ofstream file;
+    std::string path;
+    uint64_t frames = 0;        // frame() calls so far
+    uint64_t droppedFrames = 0;
+
+    // Ring of frames waiting for the writer. The emulator fills slots
+    // past head + count; the writer reads the slot at head outside the
+    // lock and only then gives it back.
+    std::vector<captureFrame> slots;
+    size_t head = 0;
+    size_t count = 0;
+    bool closing = false;
+    bool waitWhenFull;
+    bool full = false;                  // the emulator is waiting for space
+    std::mutex lock;
+    std::condition_variable wake;       // frames to write, or closing
+    std::condition_variable space;      // a slot was freed
+    std::thread writer;
+
+    // Writer thread only
+    uint64_t previous[2][64][2];
+    bool previousHires = false;
+    uint64_t lastWritten = 0;
+    std::vector<uint8_t> record;
+    std::vector<uint8_t> payload;
+    bool failed = false;
+
+    void writerLoop();
+    void writeFrame(const captureFrame& f);
+
+public:
+    explicit frameCapture(size_t queueFrames = 256, bool waitWhenFull = false);
+    ~frameCapture();
+
+    frameCapture(const frameCapture&) = delete;
+    frameCapture& operator=(const frameCapture&) = delete;
+
+    // Start a capture of the emulator from its current display on
+    void open(const std::string& filename, const chip8& emulator);
+
+    // One 60 Hz frame has passed. Stores the display if shouldDraw() is
+    // set; clearing the flag is left to the caller (the front end that
+    // shows the frame, say).
+    void frame(const chip8& emulator);
+
+    // Drain the queue, write the end record and close the file. Throws
+    // std::runtime_error if anything failed to write.
+    void close();
+
+    bool isOpen() const { return writer.joinable(); }
+    uint64_t frameCount() const { return frames; }
+    uint64_t dropped() const { return droppedFrames; }
+};
+
+// Reads a capture back, one changed frame at a time
+class captureReader {
+
+private:
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    captureFrame current;
+    bool ended = false;
+
+public:
+    uint16_t version = 0;
+    quirkProfile quirks = quirkProfile::legacy;
+    uint64_t romHash = 0;
+    uint32_t cpuHz = 0;
+    uint64_t endFrame = 0;      // frame the capture ended on, once next() returned false
+
+    explicit captureReader(const std::string& filename);
+
+    // Decode the next stored frame into `out`. Returns false at the end.
+    bool next(captureFrame& out);
+
+    // Whether the file had its end record (false for a cut-short capture)
+    bool complete() const { return ended; }
+};
+
+#endif // CHIP8_EMULATOR_CAPTURE_HPP
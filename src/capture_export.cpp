@@ -0,0 +1,417 @@
+//
+// Created by patel on 2026-10-16.
+//
+// Frame capture exporter: turns a capture (chip8_headless --capture, or
+// the SDL front end's --capture) into a video, offline.
+//
+//     chip8_capture [--scale n] run.c8fc run.y4m    // raw 4:4:4 video, 60 fps
+//     chip8_capture [--scale n] run.c8fc run.gif    // looping animated GIF
+//     chip8_capture --info run.c8fc
+//
+// Both draw a 128 × 64 canvas (lo-res pixels doubled) scaled up by
+// --scale (default 4), in the SDL front end's colours. Y4M repeats each
+// display for as many frames as it was on screen, so players and
+// encoders (ffmpeg -i run.y4m run.mp4) get the exact timing. GIF delays
+// are in hundredths of a second and browsers stretch anything under two
+// to a tenth, so the GIF shows at most 50 changes a second: a display
+// that lasted less than 2/100 s is left out. Each GIF frame only holds
+// the rectangle that changed.
+//
+
+#include "capture.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const int CANVAS_WIDTH = 128;
+static const int CANVAS_HEIGHT = 64;
+
+// As the SDL front end: off, plane 1, plane 2, both
+static const uint8_t PALETTE[4][3] = {
+    { 0x00, 0x00, 0x00 },
+    { 0xFF, 0xFF, 0xFF },
+    { 0x55, 0xAA, 0xFF },
+    { 0xFF, 0x88, 0x00 }
+};
+
+// Palette index per output pixel, row by row
+static void render(const captureFrame& f, int scale, std::vector<uint8_t>& out) {
+    int width = CANVAS_WIDTH * scale;
+    int pixelSize = scale * (f.hires ? 1 : 2);
+    out.assign(static_cast<size_t>(width) * CANVAS_HEIGHT * scale, 0);
+
+    for (int y = 0; y < f.height(); ++y) {
+        for (int x = 0; x < f.width(); ++x) {
+            uint8_t colour = static_cast<uint8_t>(f.pixel(x, y));
+            if (!colour)
+                continue;
+            for (int dy = 0; dy < pixelSize; ++dy) {
+                uint8_t* row = &out[static_cast<size_t>(y * pixelSize + dy) * width + x * pixelSize];
+                std::fill(row, row + pixelSize, colour);
+            }
+        }
+    }
+}
+
+// The display after 60 Hz frame k is what's on screen during that frame,
+// video frame k − 1, so a run of n frames ends on its final display
+static uint64_t videoFrame(uint64_t frame) {
+    return frame ? frame - 1 : 0;
+}
+
+/* -------------------- Y4M -------------------- */
+
+static void writeY4m(captureReader& in, std::ofstream& out, int scale) {
+    int width = CANVAS_WIDTH * scale;
+    int height = CANVAS_HEIGHT * scale;
+    size_t pixels = static_cast<size_t>(width) * height;
+
+    // BT.601 studio range
+    uint8_t yuv[4][3];
+    for (int c = 0; c < 4; ++c) {
+        int r = PALETTE[c][0], g = PALETTE[c][1], b = PALETTE[c][2];
+        yuv[c][0] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        yuv[c][1] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        yuv[c][2] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    char header[96];
+    std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n", width, height);
+    out << header;
+
+    std::vector<uint8_t> indices;
+    std::vector<uint8_t> planes(pixels * 3);
+    auto convert = [&](const captureFrame& f) {
+        render(f, scale, indices);
+        for (size_t i = 0; i < pixels; ++i) {
+            planes[i] = yuv[indices[i]][0];
+            planes[pixels + i] = yuv[indices[i]][1];
+            planes[2 * pixels + i] = yuv[indices[i]][2];
+        }
+    };
+    auto emit = [&](uint64_t repeats) {
+        for (uint64_t i = 0; i < repeats; ++i) {
+            out << "FRAME\n";
+            out.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+        }
+    };
+
+    captureFrame f;
+    convert(f);
+    uint64_t shownFrom = 0;
+    while (in.next(f)) {
+        emit(videoFrame(f.frame) - shownFrom);
+        convert(f);
+        shownFrom = videoFrame(f.frame);
+    }
+    emit(std::max<uint64_t>(in.endFrame - shownFrom, 1));
+}
+
+/* -------------------- GIF -------------------- */
+
+// LZW for a 4-colour GIF: 2-bit minimum code size, codes up to 12 bits,
+// the table cleared when it fills up
+static void lzwEncode(const std::vector<uint8_t>& pixels, std::vector<uint8_t>& out) {
+    const int MIN_CODE_SIZE = 2;
+    const uint16_t CLEAR = 1 << MIN_CODE_SIZE;
+    const uint16_t END = CLEAR + 1;
+
+    std::vector<uint16_t> child(4096 * 4, 0);  // code + colour -> longer code, 0 = none
+    int codeSize = MIN_CODE_SIZE + 1;
+    uint16_t maxCode = END;
+
+    std::vector<uint8_t> block;
+    uint32_t bits = 0;
+    int bitCount = 0;
+    auto flushBlock = [&] {
+        out.push_back(static_cast<uint8_t>(block.size()));
+        out.insert(out.end(), block.begin(), block.end());
+        block.clear();
+    };
+    auto put = [&](uint16_t code) {
+        bits |= static_cast<uint32_t>(code) << bitCount;
+        bitCount += codeSize;
+        while (bitCount >= 8) {
+            block.push_back(static_cast<uint8_t>(bits));
+            bits >>= 8;
+            bitCount -= 8;
+            if (block.size() == 255)
+                flushBlock();
+        }
+    };
+
+    out.push_back(MIN_CODE_SIZE);
+    put(CLEAR);
+
+    uint16_t prefix = pixels[0];
+    for (size_t i = 1; i < pixels.size(); ++i) {
+        uint8_t colour = pixels[i];
+        uint16_t longer = child[prefix * 4 + colour];
+        if (longer) {
+            prefix = longer;
+            continue;
+        }
+
+        put(prefix);
+        child[prefix * 4 + colour] = ++maxCode;
+        if (maxCode >= (1u << codeSize))
+            ++codeSize;
+        if (maxCode == 4095) {
+            put(CLEAR);
+            std::fill(child.begin(), child.end(), 0);
+            codeSize = MIN_CODE_SIZE + 1;
+            maxCode = END;
+        }
+        prefix = colour;
+    }
+
+    // The decoder adds a table entry for this last code too, which can
+    // widen the end code
+    put(prefix);
+    if (maxCode + 1u >= (1u << codeSize) && codeSize < 12)
+        ++codeSize;
+    put(END);
+    if (bitCount > 0)
+        block.push_back(static_cast<uint8_t>(bits));
+    if (!block.empty())
+        flushBlock();
+    out.push_back(0);
+}
+
+struct gifWriter {
+    std::ofstream& out;
+    int width;
+    int height;
+    std::vector<uint8_t> shown;     // the canvas as of the last image written
+    std::vector<uint8_t> bytes;
+
+    void put16(uint16_t v) {
+        bytes.push_back(static_cast<uint8_t>(v));
+        bytes.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    void begin() {
+        bytes.clear();
+        bytes.insert(bytes.end(), { 'G', 'I', 'F', '8', '9', 'a' });
+        put16(static_cast<uint16_t>(width));
+        put16(static_cast<uint16_t>(height));
+        bytes.push_back(0x91);  // global colour table of 4, 2 bits per primary
+        bytes.push_back(0);
+        bytes.push_back(0);
+        for (const uint8_t* colour : PALETTE)
+            bytes.insert(bytes.end(), colour, colour + 3);
+
+        // Loop forever
+        bytes.insert(bytes.end(), { 0x21, 0xFF, 0x0B });
+        bytes.insert(bytes.end(), { 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0' });
+        bytes.insert(bytes.end(), { 0x03, 0x01, 0x00, 0x00, 0x00 });
+        flush();
+    }
+
+    // The part of `canvas` that differs from what is shown, on screen for
+    // `delay` hundredths of a second
+    void image(const std::vector<uint8_t>& canvas, uint64_t delay) {
+        int left = 0, top = 0, right = width, bottom = height;
+        if (!shown.empty()) {
+            left = width, top = height, right = 0, bottom = 0;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    size_t i = static_cast<size_t>(y) * width + x;
+                    if (canvas[i] != shown[i]) {
+                        left = std::min(left, x);
+                        right = std::max(right, x + 1);
+                        top = std::min(top, y);
+                        bottom = std::max(bottom, y + 1);
+                    }
+                }
+            }
+            if (right == 0) {
+                left = top = 0;   // unchanged: one pixel, as it was
+                right = bottom = 1;
+            }
+        }
+        shown = canvas;
+
+        std::vector<uint8_t> pixels;
+        for (int y = top; y < bottom; ++y)
+            pixels.insert(pixels.end(), &canvas[static_cast<size_t>(y) * width + left],
+                          &canvas[static_cast<size_t>(y) * width + right]);
+
+        // A delay past 655.35 s goes on in extra one-pixel frames
+        uint16_t first = static_cast<uint16_t>(std::min<uint64_t>(delay, 0xFFFF));
+        control(first);
+        bytes.push_back(0x2C);
+        put16(static_cast<uint16_t>(left));
+        put16(static_cast<uint16_t>(top));
+        put16(static_cast<uint16_t>(right - left));
+        put16(static_cast<uint16_t>(bottom - top));
+        bytes.push_back(0);
+        lzwEncode(pixels, bytes);
+
+        for (delay -= first; delay > 0;) {
+            uint16_t part = static_cast<uint16_t>(std::min<uint64_t>(delay, 0xFFFF));
+            control(part);
+            bytes.push_back(0x2C);
+            put16(0);
+            put16(0);
+            put16(1);
+            put16(1);
+            bytes.push_back(0);
+            lzwEncode(std::vector<uint8_t>(1, canvas[0]), bytes);
+            delay -= part;
+        }
+        flush();
+    }
+
+    // Graphic control extension: keep the frame under the next one
+    void control(uint16_t delay) {
+        bytes.insert(bytes.end(), { 0x21, 0xF9, 0x04, 0x04 });
+        put16(delay);
+        bytes.push_back(0);
+        bytes.push_back(0);
+    }
+
+    void end() {
+        bytes.push_back(0x3B);
+        flush();
+    }
+
+    void flush() {
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        bytes.clear();
+    }
+};
+
+// Hundredths of a second at the start of video frame `frame`
+static uint64_t centiseconds(uint64_t frame) {
+    return (frame * 100 + 30) / 60;
+}
+
+static void writeGif(captureReader& in, std::ofstream& out, int scale) {
+    gifWriter gif{ out, CANVAS_WIDTH * scale, CANVAS_HEIGHT * scale, {}, {} };
+    gif.begin();
+
+    // A display is written once the next one shows how long it lasted
+    std::vector<uint8_t> pending;
+    std::vector<uint8_t> canvas;
+    uint64_t pendingFrom = 0;
+    render(captureFrame(), scale, pending);
+
+    captureFrame f;
+    while (in.next(f)) {
+        render(f, scale, canvas);
+        if (canvas == pending)
+            continue;
+
+        uint64_t from = videoFrame(f.frame);
+        uint64_t delay = centiseconds(from) - centiseconds(pendingFrom);
+        if (delay >= 2) {
+            gif.image(pending, delay);
+            pendingFrom = from;
+        }
+        pending.swap(canvas);
+    }
+
+    uint64_t delay = centiseconds(std::max(in.endFrame, pendingFrom)) - centiseconds(pendingFrom);
+    gif.image(pending, std::max<uint64_t>(delay, 2));
+    gif.end();
+}
+
+/* -------------------- MAIN -------------------- */
+
+static void printInfo(captureReader& in, const std::string& path) {
+    uint64_t stored = 0;
+    captureFrame f;
+    while (in.next(f))
+        ++stored;
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    double bytes = static_cast<double>(file.tellg());
+    double minutes = in.endFrame / 3600.0;
+
+    std::printf("rom hash   %016llX\n", static_cast<unsigned long long>(in.romHash));
+    std::printf("quirks     %s\n", quirkProfileName(in.quirks));
+    std::printf("cpu        %u Hz\n", in.cpuHz);
+    std::printf("length     %llu frames (%.1f s)%s\n", static_cast<unsigned long long>(in.endFrame),
+                in.endFrame / 60.0, in.complete() ? "" : ", cut short");
+    std::printf("stored     %llu frames\n", static_cast<unsigned long long>(stored));
+    std::printf("size       %.0f bytes", bytes);
+    if (minutes > 0.0)
+        std::printf(", %.1f KiB per minute", bytes / 1024.0 / minutes);
+    std::printf("\n");
+}
+
+static void printUsage() {
+    std::cerr << "Usage: chip8_capture [--scale n] <capture> <out.y4m | out.gif>\n"
+              << "       chip8_capture --info <capture>\n";
+}
+
+int main(int argc, char* argv[]) {
+    int scale = 4;
+    bool info = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--scale" && i + 1 < argc) {
+            scale = std::stoi(argv[++i]);
+            if (scale < 1 || scale > 16) {
+                std::cerr << "--scale must be 1 to 16\n";
+                return 1;
+            }
+        } else if (arg == "--info") {
+            info = true;
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.size() != (info ? 1u : 2u)) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        captureReader in(paths[0]);
+        if (info) {
+            printInfo(in, paths[0]);
+            return 0;
+        }
+
+        const std::string& outPath = paths[1];
+        auto endsWith = [&](const char* suffix) {
+            std::string s(suffix);
+            return outPath.size() >= s.size() && outPath.compare(outPath.size() - s.size(), s.size(), s) == 0;
+        };
+
+        std::ofstream out(outPath, std::ios::binary);
+        if (!out.is_open())
+            throw std::runtime_error("Failed to open output: " + outPath);
+
+        if (endsWith(".y4m")) {
+            writeY4m(in, out, scale);
+        } else if (endsWith(".gif")) {
+            writeGif(in, out, scale);
+        } else {
+            throw std::runtime_error("Output must end in .y4m or .gif: " + outPath);
+        }
+
+        if (!out.flush())
+            throw std::runtime_error("Failed to write output: " + outPath);
+        if (!in.complete())
+            std::cerr << "Capture was cut short; exported up to its last frame\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
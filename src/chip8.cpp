@@ -3,12 +3,50 @@
 //
 
 #include "chip8.hpp"
+#include "aot.hpp"
+#include "debugger.hpp"
+#include <cmath>
 #include <cstring>   // for std::memset, std::memcpy
-#include <iostream>  // optional, for debugging
 #include <fstream>
 #include <stdexcept>
 #include <vector>
 
+// Profiling builds report every instruction before it runs; otherwise
+// this compiles to nothing
+#ifdef CHIP8_PROFILE
+#define PROFILE_STEP() prof->step(pc & 0x0FFF, fetch(pc & 0x0FFF), sp)
+#else
+#define PROFILE_STEP()
+#endif
+
+// Fuzzing builds report every PC to the harness (src/fuzz.cpp), which
+// turns them into emulated-code edge coverage
+#ifdef CHIP8_COVERAGE
+#define COVERAGE_STEP() chip8CoverageStep(pc & 0x0FFF)
+#else
+#define COVERAGE_STEP()
+#endif
+
+// A basic block: a straight run of predecoded instructions, compiled once
+// and then executed back to back without going through the dispatcher
+struct codeBlock {
+    uint16_t start;
+    std::vector<decodedOp> ops;
+
+    // Blocks this one exited to before, so the next exit to the same
+    // address skips the lookup
+    codeBlock* next[2] = { nullptr, nullptr };
+    uint16_t nextPc[2] = { 0, 0 };
+};
+
+struct blockCache {
+    codeBlock* at[CODE_SIZE] = {};                // block starting at each address
+    bool codeMap[CODE_SIZE] = {};                 // bytes covered by some block
+    std::vector<std::unique_ptr<codeBlock>> owned;
+    codeBlock* last = nullptr;                    // block the last run ended with
+    bool dirty = false;                           // code was overwritten
+};
+
 
 // CHIP-8 fontset (each character is 5 bytes, 16 characters = 80 bytes)
 static const uint8_t chip8_fontset[80] = {
@@ -32,31 +70,431 @@ static const uint8_t chip8_fontset[80] = {
 
 // Constructor
 chip8::chip8() {
+    std::memset(memory, 0, sizeof(memory));
+    livePages = 0;
+
+    mode = dispatchMode::cached;
+    native = nullptr;
+    nativeWritten = ~0ull;
+    nativeChangedPages = 0;
+    dbg = nullptr;
+    romHash = 0;
+    decodedGroups = ~0ull;  // the cache starts out as garbage
+    setQuirks(quirkProfile::legacy);
+
+#ifdef CHIP8_PROFILE
+    prof = std::make_unique<profiler>();
+#endif
+
+    reset();
+}
+
+void chip8::reset() {
+    // Memory back to zeros, but only the pages something was written to;
+    // the decode cache stays warm everywhere else
+    for (size_t page = 0; page < MEMORY_SIZE / MEMORY_PAGE; ++page) {
+        if (!(livePages >> page & 1))
+            continue;
+        std::memset(memory + page * MEMORY_PAGE, 0, MEMORY_PAGE);
+        if (page * MEMORY_PAGE < CODE_SIZE)
+            invalidateCode(page * MEMORY_PAGE, MEMORY_PAGE);
+    }
+
+    // Load fontset into memory (at 0x50 by convention)
+    for (int i = 0; i < 80; ++i) {
+        memory[0x50 + i] = chip8_fontset[i];
+    }
+    livePages = 1;
+
     // Reset program counter, opcode, and index register
     pc = 0x200;   // Programs start at memory location 0x200
-    opcode = 0;
     I = 0;
     sp = 0;
     drawFlag = false;
 
-
-    // Clear display, stack, registers, memory
+    // Clear display, stack, registers, keys
     std::memset(gfx, 0, sizeof(gfx));
+    hires = false;
+    planes = 1;
     std::memset(stack, 0, sizeof(stack));
     std::memset(V, 0, sizeof(V));
-    std::memset(memory, 0, sizeof(memory));
     std::memset(key, 0, sizeof(key));
 
     // Reset timers
     delay_timer = 0;
     sound_timer = 0;
 
-    // Load fontset into memory (at 0x50 by convention)
-    for (int i = 0; i < 80; ++i) {
-        memory[0x50 + i] = chip8_fontset[i];
+    // Until a ROM loads its own pattern: a 500 Hz square wave
+    std::memset(audioPattern, 0xF0, sizeof(audioPattern));
+    pitch = 64;
+
+    faulted = false;
+    fault = faultKind::none;
+    faultingOpcode = 0;
+    stopped = false;
+    idleLength = 0;
+    idleSkipping = true;
+    idleCycles = 0;
+    romHash = 0;
+    seed(0);
+
+    // The quirk profile stays: changing it throws away every decoded
+    // instruction, and a caller reusing the instance sets it anyway
+    mode = dispatchMode::cached;
+    native = nullptr;
+    dbg = nullptr;
+    if (blocks)
+        blocks->last = nullptr;
+
+    cycleCount = 0;
+    setCpuHz(600);
+
+#ifdef CHIP8_PROFILE
+    prof->reset();
+#endif
+}
+
+void chip8::copyFrom(const chip8& other) {
+    if (this == &other)
+        return;
+
+    if (quirks != other.quirks)
+        setQuirks(other.quirks);
+    setDispatchMode(other.mode);
+
+    // Only pages either side has written can differ. Code pages are
+    // compared first, so the decode cache and blocks survive a fork
+    // wherever the code is the same (the usual case).
+    uint64_t pages = livePages | other.livePages;
+    for (size_t page = 0; page < MEMORY_SIZE / MEMORY_PAGE; ++page) {
+        if (!(pages >> page & 1))
+            continue;
+
+        size_t addr = page * MEMORY_PAGE;
+        uint8_t* dst = memory + addr;
+        bool code = addr < CODE_SIZE;
+
+        if (other.livePages >> page & 1) {
+            const uint8_t* src = other.memory + addr;
+            if (code && std::memcmp(dst, src, MEMORY_PAGE) == 0)
+                continue;
+            std::memcpy(dst, src, MEMORY_PAGE);
+        } else {
+            std::memset(dst, 0, MEMORY_PAGE);
+        }
+
+        if (code)
+            invalidateCode(static_cast<uint16_t>(addr), MEMORY_PAGE);
+    }
+    livePages = other.livePages;
+
+    std::memcpy(V, other.V, sizeof(V));
+    I = other.I;
+    pc = other.pc;
+
+    std::memcpy(gfx, other.gfx, sizeof(gfx));
+    hires = other.hires;
+    planes = other.planes;
+    drawFlag = true;
+
+    delay_timer = other.delay_timer;
+    sound_timer = other.sound_timer;
+    std::memcpy(audioPattern, other.audioPattern, sizeof(audioPattern));
+    pitch = other.pitch;
+
+    std::memcpy(stack, other.stack, sizeof(stack));
+    sp = other.sp;
+    std::memcpy(key, other.key, sizeof(key));
+
+    rngState = other.rngState;
+    romHash = other.romHash;
+    faulted = other.faulted;
+    fault = other.fault;
+    faultingOpcode = other.faultingOpcode;
+    stopped = faulted;
+    idleSkipping = other.idleSkipping;
+    idleCycles = other.idleCycles;
+
+    cpuHz = other.cpuHz;
+    cycleCount = other.cycleCount;
+    tickBaseCycle = other.tickBaseCycle;
+    ticksSinceBase = other.ticksSinceBase;
+    nextTickCycle = other.nextTickCycle;
+
+    // Chaining from our own last block would be wrong for the new PC
+    if (blocks)
+        blocks->last = nullptr;
+    resolveNative();
+}
+
+chip8::~chip8() = default;
+
+bool chip8::stateEquals(const chip8& other) const {
+    return std::memcmp(memory, other.memory, sizeof(memory)) == 0
+        && std::memcmp(V, other.V, sizeof(V)) == 0
+        && I == other.I && pc == other.pc
+        && std::memcmp(gfx, other.gfx, sizeof(gfx)) == 0 && hires == other.hires
+        && planes == other.planes
+        && delay_timer == other.delay_timer && sound_timer == other.sound_timer
+        && std::memcmp(audioPattern, other.audioPattern, sizeof(audioPattern)) == 0
+        && pitch == other.pitch
+        && std::memcmp(stack, other.stack, sizeof(stack)) == 0 && sp == other.sp
+        && std::memcmp(key, other.key, sizeof(key)) == 0
+        && rngState == other.rngState && fault == other.fault
+        && cycleCount == other.cycleCount && nextTickCycle == other.nextTickCycle;
+}
+
+/* -------------------- SAVE STATES -------------------- */
+
+// Little-endian field writers/readers for the save state
+static uint8_t* put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+    p = put16(p, v & 0xFFFF);
+    return put16(p, v >> 16);
+}
+
+static uint8_t* put64(uint8_t* p, uint64_t v) {
+    p = put32(p, v & 0xFFFFFFFF);
+    return put32(p, v >> 32);
+}
+
+static uint16_t get16(const uint8_t*& p) {
+    uint16_t v = p[0] | (p[1] << 8);
+    p += 2;
+    return v;
+}
+
+static uint32_t get32(const uint8_t*& p) {
+    uint32_t lo = get16(p);
+    return lo | (static_cast<uint32_t>(get16(p)) << 16);
+}
+
+static uint64_t get64(const uint8_t*& p) {
+    uint64_t lo = get32(p);
+    return lo | (static_cast<uint64_t>(get32(p)) << 32);
+}
+
+std::vector<uint8_t> chip8::saveState() const {
+    std::vector<uint8_t> out;
+    saveState(out);
+    return out;
+}
+
+void chip8::saveState(std::vector<uint8_t>& out) const {
+    out.resize(saveStateLayout::SIZE);
+    uint8_t* p = out.data();
+
+    std::memcpy(p, "C8SS", 4);
+    put16(p + 4, saveStateLayout::VERSION);
+    put16(p + 6, 0);
+
+    std::memcpy(p + saveStateLayout::MEMORY, memory, sizeof(memory));
+
+    p += saveStateLayout::GFX;
+    for (const auto& plane : gfx) {
+        for (const auto& row : plane) {
+            p = put64(p, row[0]);
+            p = put64(p, row[1]);
+        }
     }
 
-    std::cout << "CHIP-8 initialized. PC set to 0x200, fontset loaded.\n";
+    std::memcpy(p, V, sizeof(V));
+    p += sizeof(V);
+    p = put16(p, I);
+    p = put16(p, pc);
+    p = put16(p, sp);
+    for (uint16_t entry : stack)
+        p = put16(p, entry);
+
+    *p++ = delay_timer;
+    *p++ = sound_timer;
+    std::memcpy(p, key, sizeof(key));
+    p += sizeof(key);
+
+    p = put64(p, rngState);
+    *p++ = drawFlag;
+    *p++ = static_cast<uint8_t>(fault);   // 0 = running, 1 = unknown opcode as before
+    p = put16(p, faultingOpcode);
+
+    p = put32(p, cpuHz);
+    p = put64(p, cycleCount);
+    p = put64(p, tickBaseCycle);
+    p = put64(p, ticksSinceBase);
+    *p++ = hires;
+    *p++ = planes;
+    *p++ = pitch;
+    std::memcpy(p, audioPattern, sizeof(audioPattern));
+}
+
+void chip8::loadState(const uint8_t* data, size_t size) {
+    if (size != saveStateLayout::SIZE || std::memcmp(data, "C8SS", 4) != 0) {
+        throw std::runtime_error("Not a CHIP-8 save state");
+    }
+
+    const uint8_t* p = data + 4;
+    if (get16(p) != saveStateLayout::VERSION) {
+        throw std::runtime_error("Unsupported save state version");
+    }
+
+    // Read and check the CPU state before anything is changed
+    p = data + saveStateLayout::CPU;
+    const uint8_t* registers = p;
+    p += sizeof(V);
+    uint16_t newI = get16(p);
+    uint16_t newPc = get16(p);
+    uint16_t newSp = get16(p);
+    uint16_t newStack[16];
+    for (uint16_t& entry : newStack)
+        entry = get16(p);
+
+    uint8_t newDelay = *p++;
+    uint8_t newSound = *p++;
+    const uint8_t* keys = p;
+    p += sizeof(key);
+
+    uint64_t newRng = get64(p);
+    bool newDrawFlag = *p++ != 0;
+    uint8_t kind = *p++;
+    uint16_t newFaultingOpcode = get16(p);
+
+    uint32_t newCpuHz = get32(p);
+    uint64_t newCycleCount = get64(p);
+    uint64_t newTickBase = get64(p);
+    uint64_t newTicksSinceBase = get64(p);
+    bool newHires = *p++ != 0;
+    uint8_t newPlanes = *p++ & 3;
+    uint8_t newPitch = *p++;
+    const uint8_t* pattern = p;
+
+    if (newSp > 16) {
+        throw std::runtime_error("Save state has a bad stack pointer");
+    }
+    if (kind > static_cast<uint8_t>(faultKind::memoryRange)) {
+        throw std::runtime_error("Save state has an unknown fault");
+    }
+
+    // Only copy memory pages that differ, so the decode cache and compiled
+    // blocks stay warm for the code that didn't change (rewind)
+    const uint8_t* mem = data + saveStateLayout::MEMORY;
+    for (size_t page = 0; page < MEMORY_SIZE; page += 256) {
+        if (std::memcmp(memory + page, mem + page, 256) != 0) {
+            std::memcpy(memory + page, mem + page, 256);
+            markLive(static_cast<uint16_t>(page), 256);
+            if (page < CODE_SIZE)
+                invalidateCode(page, 256);
+        }
+    }
+
+    p = data + saveStateLayout::GFX;
+    for (auto& plane : gfx) {
+        for (auto& row : plane) {
+            row[0] = get64(p);
+            row[1] = get64(p);
+        }
+    }
+
+    std::memcpy(V, registers, sizeof(V));
+    I = newI;
+    pc = newPc;
+    sp = newSp;
+    std::memcpy(stack, newStack, sizeof(stack));
+
+    delay_timer = newDelay;
+    sound_timer = newSound;
+    std::memcpy(key, keys, sizeof(key));
+
+    rngState = newRng;
+    drawFlag = newDrawFlag;
+    fault = static_cast<faultKind>(kind);
+    faulted = fault != faultKind::none;
+    stopped = faulted;
+    faultingOpcode = newFaultingOpcode;
+
+    // setCpuHz() keeps the speed sane, then the tick sequence is put back
+    cycleCount = newCycleCount;
+    setCpuHz(newCpuHz);
+    tickBaseCycle = newTickBase;
+    ticksSinceBase = newTicksSinceBase;
+    scheduleNextTick();
+    hires = newHires;
+    planes = newPlanes;
+    pitch = newPitch;
+    std::memcpy(audioPattern, pattern, sizeof(audioPattern));
+
+    // Block chaining may point into the middle of what is now a
+    // different path through the code
+    if (blocks)
+        blocks->last = nullptr;
+}
+
+void chip8::seed(uint64_t s) {
+    // splitmix64 step so nearby seeds give unrelated streams
+    // (xorshift also must never start from zero)
+    uint64_t z = s + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    rngState = z ? z : 1;
+}
+
+uint8_t chip8::nextRandom(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<uint8_t>((state * 0x2545F4914F6CDD1Dull) >> 56);
+}
+
+void chip8::setKeys(uint16_t mask) {
+    for (int i = 0; i < 16; ++i) {
+        key[i] = (mask >> i) & 1;
+    }
+}
+
+void chip8::getDisplay(uint8_t* out) const {
+    int width = getDisplayWidth();
+    for (int y = 0; y < getDisplayHeight(); ++y) {
+        for (int x = 0; x < width; ++x) {
+            int shift = 63 - (x & 63);
+            out[x + y * width] = ((gfx[0][y][x >> 6] >> shift) & 1)
+                               | ((gfx[1][y][x >> 6] >> shift) & 1) << 1;
+        }
+    }
+}
+
+uint64_t chip8::displayHash() const {
+    // FNV-1a, one whole word at a time, over the visible part only
+    uint64_t h = 0xCBF29CE484222325ull;
+    auto hashPlane = [&](const uint64_t (*plane)[2]) {
+        for (int y = 0; y < getDisplayHeight(); ++y) {
+            h ^= plane[y][0];
+            h *= 0x100000001B3ull;
+            if (hires) {
+                h ^= plane[y][1];
+                h *= 0x100000001B3ull;
+            }
+        }
+    };
+
+    hashPlane(gfx[0]);
+
+    // Plane 1 only counts once something is on it, so single-plane
+    // screens hash the same as they always have
+    for (int y = 0; y < getDisplayHeight(); ++y) {
+        if (gfx[1][y][0] | (hires ? gfx[1][y][1] : 0)) {
+            hashPlane(gfx[1]);
+            break;
+        }
+    }
+    return h;
+}
+
+double chip8::getAudioRate() const {
+    return 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
 }
 
 void chip8::loadROM(const std::string &filename) {
@@ -66,440 +504,1247 @@ void chip8::loadROM(const std::string &filename) {
     }
 
     std::streampos size = rom.tellg();
-    if (size > (4096 - 0x200)) {
+    if (size > static_cast<std::streamoff>(MEMORY_SIZE - 0x200)) {
         throw std::runtime_error("ROM too large to fit in memory");
     }
 
-    std::vector<char> buffer(size);
+    // Read straight into memory; no staging buffer
     rom.seekg(0, std::ios::beg);
-    rom.read(buffer.data(), size);
-    rom.close();
+    if (!rom.read(reinterpret_cast<char*>(memory + 0x200), size)) {
+        throw std::runtime_error("Failed to read ROM: " + filename);
+    }
+    markLive(0x200, static_cast<int>(size));
+
+    romLoaded(static_cast<size_t>(size), hashROM(memory + 0x200, static_cast<size_t>(size)));
+}
 
-    for (size_t i = 0; i < buffer.size(); ++i) {
-        memory[0x200 + i] = static_cast<uint8_t>(buffer[i]);
+void chip8::loadROM(const uint8_t* data, size_t size) {
+    loadROM(data, size, hashROM(data, size));
+}
+
+void chip8::loadROM(const uint8_t* data, size_t size, uint64_t hash) {
+    // Anything past 0x1000 is only reachable as XO-CHIP data
+    if (size > MEMORY_SIZE - 0x200) {
+        throw std::runtime_error("ROM too large to fit in memory");
     }
+
+    if (size) {
+        std::memcpy(memory + 0x200, data, size);
+        markLive(0x200, static_cast<int>(size));
+    }
+    romLoaded(size, hash);
 }
 
-void chip8::emulateCycle() {
-    // Fetch 2-byte opcode
-    opcode = memory[pc] << 8 | memory[pc + 1];
+uint64_t chip8::hashROM(const uint8_t* data, size_t size) {
+    // FNV-1a of the ROM image, so recordings and quirk databases can
+    // recognise the program
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
 
-    // Decode & execute
-    switch (opcode & 0xF000) { // bitwise and for the first 4 bits of hex using the mask
-        case 0x0000:
-            switch (opcode & 0x00FF) {
-                case 0x00E0: // CLS (clear the screen and move to next instruction)
-                    std::memset(gfx, 0, sizeof(gfx));
-                    pc += 2;
-                    break;
-
-                case 0x00EE: // RET (pop return address and continue)
-                    --sp;
-                    pc = stack[sp];
-                 //   pc += 2; not needed?
-                    break;
-
-
-                default:
-                    std::cerr << "Unknown opcode [0x0000]: "
-                              << std::hex << opcode << "\n";
-                    break;
-            }
-            break;
+void chip8::romLoaded(size_t size, uint64_t hash) {
+    romHash = hash;
 
-        case 0x1000: //1NNN Jump
-            pc = opcode & 0x0FFF;
-            break;
+    // Only the ROM's bytes changed; decoded code anywhere else still holds
+    if (size)
+        invalidateCode(0x200, static_cast<int>(std::min(size, CODE_SIZE - 0x200)));
+    resolveNative();
 
-            //save return address and jump into subroutine
-        case 0x2000: // CALL addr
-            stack[sp] = pc + 2; // pc is current instruction, pc + 2 is next instruction (2 bytes)
-            ++sp; //move stack pointer
-            pc = opcode & 0x0FFF;
-            break;
+#ifdef CHIP8_PROFILE
+    prof->reset();
+#endif
+}
 
-            //skip instruction if vx = nn
-        case 0x3000: {
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t nn = opcode & 0x00FF;
-            if (V[x] == nn) pc += 4;
-            else pc += 2;
-            break;
-        }
+/*
+    Opcode handlers.
 
-            //opposite of 3XNN, skip if not equal
-        case 0x4000: {
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t nn = opcode & 0x00FF;
-            if (V[x] != nn) pc += 4;
-            else pc += 2;
-            break;
-        }
+    decode() turns a raw opcode into a decodedOp: a pointer to one of these
+    handlers plus the operands already pulled out of the opcode. Each
+    handler executes one instruction and moves the program counter.
 
-        case 0x5000: {  // 5XY0
-            if ((opcode & 0x000F) != 0) {
-                std::cerr << "Invalid 5XY? opcode\n";
-                break;
-            }
+    Handlers whose behaviour depends on the quirk profile are templates
+    over it; the `if constexpr` branches are resolved at compile time.
+*/
+struct chip8Ops {
 
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t y = (opcode & 0x00F0) >> 4;
+    // Data address seen through the profile: 12 bits, or 16 for XO-CHIP
+    template <typename Q>
+    static uint16_t dataAddr(unsigned addr) {
+        return Q::xoChip ? static_cast<uint16_t>(addr) : addr & 0x0FFF;
+    }
 
-            if (V[x] == V[y])
-                pc += 4;
-            else
-                pc += 2;
+    // Classic profiles stop at 0xFFF: an access of `length` bytes from I
+    // that runs past it is a fault rather than a silent wrap. XO-CHIP
+    // wraps at 64 KiB by design.
+    template <typename Q>
+    static bool inRange(chip8& c, unsigned length) {
+        if (Q::xoChip || c.I + length <= CODE_SIZE)
+            return true;
+        c.raiseFault(faultKind::memoryRange);
+        return false;
+    }
 
-            break;
-        }
-        case 0x9000: {  // 9XY0 (mirror of 5XY0, but it skips for not equal)
-            if ((opcode & 0x000F) != 0) {
-                std::cerr << "Invalid 5XY? opcode\n";
-                break;
-            }
+    // After a write to memory. Only the first 4 KiB can hold code, so
+    // XO-CHIP data further up never touches the decode cache.
+    template <typename Q>
+    static void wroteData(chip8& c, uint16_t addr, int length) {
+        c.markLive(addr, length);
+        if (Q::xoChip && addr >= CODE_SIZE && addr + static_cast<size_t>(length) <= MEMORY_SIZE)
+            return;
+        c.invalidateCode(addr, length);
+    }
 
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t y = (opcode & 0x00F0) >> 4;
+    // How far a taken skip moves PC. XO-CHIP skips over the whole of a
+    // 4-byte F000 NNNN.
+    template <typename Q>
+    static uint16_t skipLength(const chip8& c) {
+        if constexpr (Q::xoChip)
+            return c.fetch((c.pc + 2) & 0x0FFF) == 0xF000 ? 6 : 4;
+        return 4;
+    }
 
-            if (V[x] != V[y])
-                pc += 4;
-            else
-                pc += 2;
+    static void op00E0(chip8& c, const decodedOp&) { // CLS (clear the screen and move to next instruction)
+        // Only the selected planes (always just plane 0 outside XO-CHIP)
+        for (int p = 0; p < 2; ++p) {
+            if (c.planes & (1 << p))
+                std::memset(c.gfx[p], 0, sizeof(c.gfx[p]));
+        }
+        c.screenChanged();
+        c.pc += 2;
+    }
 
-            break;
+    static void op00EE(chip8& c, const decodedOp&) { // RET (pop return address and continue)
+        if (c.sp == 0) {
+            c.raiseFault(faultKind::stackUnderflow);
+            return;
         }
+        --c.sp;
+        c.pc = c.stack[c.sp];
+    }
 
-        case 0x6000: { //set vx to value of nn
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t nn = opcode & 0x00FF;
+    static void op1NNN(chip8& c, const decodedOp& op) { //1NNN Jump
+        uint16_t from = c.pc & 0x0FFF;
+        c.pc = op.nnn;
 
-            V[x] = nn;
-            pc += 2;
-            break;
+        // Only a jump to itself or back over two instructions can close
+        // one of the idle loops
+        if (c.idleSkipping && (op.nnn == from || op.nnn + 4 == from))
+            c.checkIdleJump(from);
+    }
+
+    //save return address and jump into subroutine
+    static void op2NNN(chip8& c, const decodedOp& op) { // CALL addr
+        if (c.sp == 16) {
+            c.raiseFault(faultKind::stackOverflow);
+            return;
         }
+        c.stack[c.sp] = c.pc + 2; // pc is current instruction, pc + 2 is next instruction (2 bytes)
+        ++c.sp; //move stack pointer
+        c.pc = op.nnn;
+    }
 
-            //CARRY NOT IMPLEMENTED YET
-        case 0x7000: { //add value of nn to vx
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t nn = opcode & 0x00FF;
+    //skip instruction if vx = nn
+    template <typename Q>
+    static void op3XNN(chip8& c, const decodedOp& op) {
+        c.pc += (c.V[op.x] == op.nn) ? skipLength<Q>(c) : 2;
+    }
 
-            V[x] += nn;
-            pc += 2;
-            break;
+    //opposite of 3XNN, skip if not equal
+    template <typename Q>
+    static void op4XNN(chip8& c, const decodedOp& op) {
+        c.pc += (c.V[op.x] != op.nn) ? skipLength<Q>(c) : 2;
+    }
+
+    template <typename Q>
+    static void op5XY0(chip8& c, const decodedOp& op) {
+        c.pc += (c.V[op.x] == c.V[op.y]) ? skipLength<Q>(c) : 2;
+    }
+
+    // 9XY0 (mirror of 5XY0, but it skips for not equal)
+    template <typename Q>
+    static void op9XY0(chip8& c, const decodedOp& op) {
+        c.pc += (c.V[op.x] != c.V[op.y]) ? skipLength<Q>(c) : 2;
+    }
+
+    // 5XY2 — XO-CHIP: store VX through VY (either direction) at I, I unchanged
+    template <typename Q>
+    static void op5XY2(chip8& c, const decodedOp& op) {
+        int step = op.x <= op.y ? 1 : -1;
+        int count = (op.y - op.x) * step + 1;
+        for (int i = 0; i < count; ++i) {
+            c.memory[dataAddr<Q>(c.I + i)] = c.V[op.x + i * step];
+        }
+        wroteData<Q>(c, c.I, count);
+        c.pc += 2;
+    }
+
+    // 5XY3 — XO-CHIP: load VX through VY (either direction) from I
+    template <typename Q>
+    static void op5XY3(chip8& c, const decodedOp& op) {
+        int step = op.x <= op.y ? 1 : -1;
+        int count = (op.y - op.x) * step + 1;
+        for (int i = 0; i < count; ++i) {
+            c.V[op.x + i * step] = c.memory[dataAddr<Q>(c.I + i)];
         }
+        c.pc += 2;
+    }
 
-        case 0x8000: { //ALU
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t y = (opcode & 0x00F0) >> 4;
+    static void op6XNN(chip8& c, const decodedOp& op) { //set vx to value of nn
+        c.V[op.x] = op.nn;
+        c.pc += 2;
+    }
 
-            switch (opcode & 0x000F) {
-                case 0x0: { //VX is set to the value of VY
-                    V[x] = V[y];
-                    break;
-                }
+    static void op7XNN(chip8& c, const decodedOp& op) { //add value of nn to vx (no carry flag)
+        c.V[op.x] += op.nn;
+        c.pc += 2;
+    }
 
-                case 0x1: { //bitwise OR and set it to x
-                    V[x] = V[x] | V[y];
-                    break;
-                }
+    /* -------------------- ALU (8XY?) -------------------- */
+
+    static void op8XY0(chip8& c, const decodedOp& op) { //VX is set to the value of VY
+        c.V[op.x] = c.V[op.y];
+        c.pc += 2;
+    }
+
+    template <typename Q>
+    static void op8XY1(chip8& c, const decodedOp& op) { //bitwise OR and set it to x
+        c.V[op.x] = c.V[op.x] | c.V[op.y];
+        if constexpr (Q::logicResetsVF)
+            c.V[0xF] = 0;
+        c.pc += 2;
+    }
+
+    template <typename Q>
+    static void op8XY2(chip8& c, const decodedOp& op) { //bitwise AND
+        c.V[op.x] = c.V[op.x] & c.V[op.y];
+        if constexpr (Q::logicResetsVF)
+            c.V[0xF] = 0;
+        c.pc += 2;
+    }
 
-                case 0x2: { //bitwise AND
-                    V[x] = V[x] & V[y];
-                    break;
+    template <typename Q>
+    static void op8XY3(chip8& c, const decodedOp& op) { //bitwise XOR
+        c.V[op.x] = c.V[op.x] ^ c.V[op.y];
+        if constexpr (Q::logicResetsVF)
+            c.V[0xF] = 0;
+        c.pc += 2;
+    }
+
+    static void op8XY4(chip8& c, const decodedOp& op) { //add
+        uint16_t sum = c.V[op.x] + c.V[op.y];
+
+        c.V[0xF] = (sum > 0xFF) ? 1 : 0; // carry flag
+        c.V[op.x] = sum & 0xFF;         // keep lower 8 bits
+        c.pc += 2;
+    }
+
+    static void op8XY5(chip8& c, const decodedOp& op) { //subtract x-y
+        // Set VF = 1 if VX >= VY (no borrow), else 0
+        c.V[0xF] = (c.V[op.x] >= c.V[op.y]) ? 1 : 0;
+
+        c.V[op.x] = c.V[op.x] - c.V[op.y]; // wraps automatically if negative
+        c.pc += 2;
+    }
+
+    static void op8XY7(chip8& c, const decodedOp& op) { //subtract y-x
+        // Set VF = 1 if VY >= VX (no borrow), else 0
+        c.V[0xF] = (c.V[op.y] >= c.V[op.x]) ? 1 : 0;
+
+        c.V[op.x] = c.V[op.y] - c.V[op.x]; // wraps automatically if negative
+        c.pc += 2;
+    }
+
+    template <typename Q>
+    static void op8XY6(chip8& c, const decodedOp& op) { // 8XY6 - Shift right VX
+        uint8_t value = Q::shiftUsesVY ? c.V[op.y] : c.V[op.x];
+        c.V[0xF] = value & 0x1;   // save least-significant bit
+        c.V[op.x] = value >> 1; //shift
+        c.pc += 2;
+    }
+
+    template <typename Q>
+    static void op8XYE(chip8& c, const decodedOp& op) { // 8XYE - Shift left VX
+        uint8_t value = Q::shiftUsesVY ? c.V[op.y] : c.V[op.x];
+        c.V[0xF] = (value & 0x80) >> 7; // MSB
+        c.V[op.x] = value << 1; //shift left
+        c.pc += 2;
+    }
+
+    static void opANNN(chip8& c, const decodedOp& op) { //Set index register
+        c.I = op.nnn;
+        c.pc += 2;
+    }
+
+    template <typename Q>
+    static void opBNNN(chip8& c, const decodedOp& op) { // BNNN - Jump with offset
+        // SUPER-CHIP reads it as BXNN: jump to XNN + VX
+        c.pc = op.nnn + (Q::jumpUsesVX ? c.V[op.x] : c.V[0]);
+    }
+
+    static void opCXNN(chip8& c, const decodedOp& op) { //CXNN - Random
+        c.V[op.x] = c.nextRandom() & op.nn;
+        c.pc += 2;
+    }
+
+    /*
+        Sprite drawing, shared by DXYN (8 pixels wide, N rows) and the
+        SUPER-CHIP DXY0 (16 × 16). Sprite rows are W bits, read big-endian
+        from memory[I].
+
+        Lo-res: each display row is one uint64_t, bit 63 = leftmost pixel.
+        Line the sprite row up with the left edge, then rotate it right by
+        x so pixels past the right edge wrap to the left (or just shift
+        it, when the profile clips sprites instead). XOR draws the whole
+        row at once, and AND with the old row gives every pixel that gets
+        switched off (collisions).
+
+        Hi-res: the same, over a 128-pixel row held in two words.
+
+        XO-CHIP: each selected plane is drawn on its own with the sprite
+        data that follows the previous plane's, and collisions on either
+        plane set VF.
+    */
+    template <typename Q, int W>
+    static uint64_t drawPlane(chip8& c, uint64_t (*plane)[2], uint16_t addr,
+                              unsigned x, unsigned y, int height) {
+        const int rowsOnScreen = c.hires ? 64 : 32;
+
+        uint64_t collisions = 0;
+        for (int row = 0; row < height; row++) {
+            uint64_t sprite;
+            if constexpr (W == 16) {
+                uint16_t at = addr + row * 2;
+                sprite = static_cast<uint64_t>(c.memory[dataAddr<Q>(at)] << 8
+                                               | c.memory[dataAddr<Q>(at + 1)]) << 48;
+            } else {
+                sprite = static_cast<uint64_t>(c.memory[dataAddr<Q>(addr + row)]) << 56;
+            }
+
+            uint64_t* line = plane[(y + row) % rowsOnScreen];
+
+            if (!c.hires) {
+                if constexpr (Q::clipSprites) {
+                    sprite >>= x;
+                } else {
+                    sprite = (sprite >> x) | (sprite << ((64 - x) & 63));
                 }
 
-                case 0x3: { //bitwise XOR
-                    V[x] = V[x] ^ V[y];
-                    break;
+                collisions |= line[0] & sprite;
+                line[0] ^= sprite;
+                continue;
+            }
 
+            uint64_t left, right;
+            if (x < 64) {
+                left = sprite >> x;
+                right = x ? sprite << (64 - x) : 0;
+            } else {
+                left = 0;
+                right = sprite >> (x - 64);
+
+                // Pixels pushed past column 127 come back in at column 0
+                if constexpr (!Q::clipSprites) {
+                    if (x > 64)
+                        left = sprite << (128 - x);
                 }
-                case 0x4: { //add
-                    uint16_t sum = V[x] + V[y];
+            }
+
+            collisions |= (line[0] & left) | (line[1] & right);
+            line[0] ^= left;
+            line[1] ^= right;
+        }
+        return collisions;
+    }
+
+    template <typename Q, int W>
+    static void drawSprite(chip8& c, const decodedOp& op, int height) {
+#ifdef CHIP8_PROFILE
+        drawTimer timer(*c.prof);
+#endif
+
+        const int width = c.hires ? 128 : 64;
+        const int rowsOnScreen = c.hires ? 64 : 32;
 
-                    V[0xF] = (sum > 0xFF) ? 1 : 0; // carry flag
-                    V[x] = sum & 0xFF;            // keep lower 8 bits
+        // Starting position, wrapped onto the screen
+        unsigned x = c.V[op.x] % width;
+        unsigned y = c.V[op.y] % rowsOnScreen;
 
-                    break;
+        // Bytes of sprite data per plane, before any clipping
+        const int spriteBytes = height * W / 8;
+        if (!inRange<Q>(c, spriteBytes))
+            return;
+
+        if constexpr (Q::clipSprites) {
+            if (static_cast<int>(y) + height > rowsOnScreen)
+                height = rowsOnScreen - y;
+        }
+
+        uint64_t collisions = 0;
+        if constexpr (Q::xoChip) {
+            uint16_t addr = c.I;
+            for (int p = 0; p < 2; ++p) {
+                if (c.planes & (1 << p)) {
+                    collisions |= drawPlane<Q, W>(c, c.gfx[p], addr, x, y, height);
+                    addr += spriteBytes;
                 }
-                case 0x5: { //subtract x-y
-                    // Set VF = 1 if VX >= VY (no borrow), else 0
-                    V[0xF] = (V[x] >= V[y]) ? 1 : 0;
+            }
+        } else {
+            collisions = drawPlane<Q, W>(c, c.gfx[0], c.I, x, y, height);
+        }
+
+        // VF is the collision flag
+        c.V[0xF] = collisions ? 1 : 0;
+
+        // Move program counter to the next instruction
+        c.pc += 2;
+
+        // Signal the renderer that the screen needs to be redrawn
+        c.drawFlag = true;
+    }
+
+    template <typename Q>
+    static void opDXYN(chip8& c, const decodedOp& op) { // DXYN — Draw sprite at (VX, VY) with height N
+        /*  Opcode format: D X Y N
+
+            X = index of register VX
+            Y = index of register VY
+            N = number of sprite rows (height)
+
+            Each sprite row is 8 pixels wide (1 byte).
+            Sprite data starts at memory[I]. */
+        drawSprite<Q, 8>(c, op, op.n);
+    }
+
+    template <typename Q>
+    static void opDXY0(chip8& c, const decodedOp& op) { // DXY0 — SUPER-CHIP 16 × 16 sprite, 2 bytes per row
+        drawSprite<Q, 16>(c, op, 16);
+    }
+
+    /* -------------------- SUPER-CHIP DISPLAY -------------------- */
+
+    // Scrolls move whole words: a memmove for rows, shifts for columns.
+    // They count pixels of the current resolution, and only move the
+    // selected planes.
+
+    static void op00CN(chip8& c, const decodedOp& op) { // 00CN — Scroll down N rows
+        int height = c.hires ? 64 : 32;
+        int n = op.n < height ? op.n : height;
 
-                    V[x] = V[x] - V[y]; // wraps automatically if negative
-                    break;
+        for (int p = 0; p < 2; ++p) {
+            if (!(c.planes & (1 << p)))
+                continue;
+            std::memmove(c.gfx[p][n], c.gfx[p][0], (height - n) * sizeof(c.gfx[p][0]));
+            std::memset(c.gfx[p][0], 0, n * sizeof(c.gfx[p][0]));
+        }
+        c.screenChanged();
+        c.pc += 2;
+    }
+
+    static void op00FB(chip8& c, const decodedOp&) { // 00FB — Scroll right 4 pixels
+        for (int p = 0; p < 2; ++p) {
+            if (!(c.planes & (1 << p)))
+                continue;
+            if (c.hires) {
+                for (auto& line : c.gfx[p]) {
+                    line[1] = (line[1] >> 4) | (line[0] << 60);
+                    line[0] >>= 4;
                 }
-                case 0x7: { //subtract y-x
-                    // Set VF = 1 if VX >= VY (no borrow), else 0
-                    V[0xF] = (V[y] >= V[x]) ? 1 : 0;
+            } else {
+                for (int y = 0; y < 32; ++y)
+                    c.gfx[p][y][0] >>= 4;
+            }
+        }
+        c.screenChanged();
+        c.pc += 2;
+    }
 
-                    V[x] = V[y] - V[x]; // wraps automatically if negative
-                    break;
+    static void op00FC(chip8& c, const decodedOp&) { // 00FC — Scroll left 4 pixels
+        for (int p = 0; p < 2; ++p) {
+            if (!(c.planes & (1 << p)))
+                continue;
+            if (c.hires) {
+                for (auto& line : c.gfx[p]) {
+                    line[0] = (line[0] << 4) | (line[1] >> 60);
+                    line[1] <<= 4;
                 }
+            } else {
+                for (int y = 0; y < 32; ++y)
+                    c.gfx[p][y][0] <<= 4;
+            }
+        }
+        c.screenChanged();
+        c.pc += 2;
+    }
 
-                case 0x6: { // 8XY6 - Shift right VX
+    static void op00FE(chip8& c, const decodedOp&) { // 00FE — Lo-res (64 × 32)
+        c.setResolution(false);
+        c.pc += 2;
+    }
 
-                    V[0xF] = V[x] & 0x1;   // save least-significant bit
-                    V[x] >>= 1; //shift
+    static void op00FF(chip8& c, const decodedOp&) { // 00FF — Hi-res (128 × 64)
+        c.setResolution(true);
+        c.pc += 2;
+    }
 
-                    pc += 2;
-                    break;
-                }
-                case 0xE: { // 8XYE - Shift left VX
+    // There are only 16 keys; anything above is a fault, not key[16+]
+    static bool validKey(chip8& c, const decodedOp& op) {
+        if (c.V[op.x] <= 0xF)
+            return true;
+        c.raiseFault(faultKind::badKey);
+        return false;
+    }
 
-                    V[0xF] = (V[x] & 0x80) >> 7; // MSB
-                    V[x] <<= 1; //shift left
+    template <typename Q>
+    static void opEX9E(chip8& c, const decodedOp& op) { // EX9E - Skip if key in VX is pressed
+        if (!validKey(c, op))
+            return;
+        c.pc += (c.key[c.V[op.x]] != 0) ? skipLength<Q>(c) : 2;
+    }
 
-                    pc += 2;
-                    break;
-                }
+    template <typename Q>
+    static void opEXA1(chip8& c, const decodedOp& op) { // EXA1 - Skip if key in VX is NOT pressed
+        if (!validKey(c, op))
+            return;
+        c.pc += (c.key[c.V[op.x]] == 0) ? skipLength<Q>(c) : 2;
+    }
+
+    /* -------------------- FX?? -------------------- */
+
+    // FX07 — Set VX = delay timer value
+    static void opFX07(chip8& c, const decodedOp& op) {
+        c.V[op.x] = c.delay_timer;   // Copy delay timer into VX
+        c.pc += 2;                   // Move to next instruction
+    }
+
+    // FX15 — Set delay timer = VX
+    static void opFX15(chip8& c, const decodedOp& op) {
+        c.delay_timer = c.V[op.x];   // Load delay timer from VX
+        c.pc += 2;
+    }
+
+    // FX18 — Set sound timer = VX
+    static void opFX18(chip8& c, const decodedOp& op) {
+        c.sound_timer = c.V[op.x];   // Load sound timer from VX
+        c.pc += 2;
+    }
+
+    // FX1E — Add VX to index register I
+    template <typename Q>
+    static void opFX1E(chip8& c, const decodedOp& op) {
+        c.I += c.V[op.x];            // Add VX to I
+
+        // Optional compatibility behavior:
+        // Set VF if I overflows past 0x0FFF
+        if constexpr (Q::indexOverflowFlag)
+            c.V[0xF] = (c.I > 0x0FFF) ? 1 : 0;
 
-                default:
-                    break;
+        // Keep I within the address space (12 bits, or 16 for XO-CHIP)
+        c.I = dataAddr<Q>(c.I);
+
+        c.pc += 2;
+    }
+
+    // FX0A — Wait for a key press, then store it in VX
+    static void opFX0A(chip8& c, const decodedOp& op) {
+        // Check all 16 keys
+        for (int i = 0; i < 16; i++) {
+            if (c.key[i]) {       // If key i is currently pressed
+                c.V[op.x] = i;    // Store key value in VX
+                c.pc += 2;        // Only advance PC if a key was pressed
+                return;
             }
-            pc += 2;
-            break;
         }
-        case 0xA000: { //Set index register
-            I = opcode & 0x0FFF;
-            pc += 2;
-            break;
+        // Otherwise, this instruction repeats (blocks), and nothing
+        // changes until the keys do
+        if (c.idleSkipping)
+            c.enterIdle(1);
+    }
+
+    // FX29 — Set I to the font sprite address for digit in VX
+    static void opFX29(chip8& c, const decodedOp& op) {
+        // Each font character is 5 bytes
+        // Fontset starts at memory location 0x50
+        c.I = 0x50 + (c.V[op.x] & 0x0F) * 5;
+        c.pc += 2;
+    }
+
+    // FX33 — Store BCD representation of VX at memory[I..I+2]
+    template <typename Q>
+    static void opFX33(chip8& c, const decodedOp& op) {
+        if (!inRange<Q>(c, 3))
+            return;
+        uint8_t value = c.V[op.x];
+
+        c.memory[dataAddr<Q>(c.I)] = value / 100;            // Hundreds digit
+        c.memory[dataAddr<Q>(c.I + 1)] = (value / 10) % 10;  // Tens digit
+        c.memory[dataAddr<Q>(c.I + 2)] = value % 10;         // Ones digit
+
+        wroteData<Q>(c, c.I, 3);
+        c.pc += 2;
+    }
+
+    // FX55 — Store registers V0 through VX in memory starting at I
+    template <typename Q>
+    static void opFX55(chip8& c, const decodedOp& op) {
+        if (!inRange<Q>(c, op.x + 1))
+            return;
+        for (int i = 0; i <= op.x; i++) {
+            c.memory[dataAddr<Q>(c.I + i)] = c.V[i];
         }
-        case 0xB000: { // BNNN - Jump with offset (original CHIP-8)
-            uint16_t addr = opcode & 0x0FFF;
-            pc = addr + V[0];
-            break;
+        wroteData<Q>(c, c.I, op.x + 1);
+        if constexpr (Q::loadStoreIncrementsI)
+            c.I = dataAddr<Q>(c.I + op.x + 1);
+        c.pc += 2;
+    }
+
+    // FX65 — Load registers V0 through VX from memory starting at I
+    template <typename Q>
+    static void opFX65(chip8& c, const decodedOp& op) {
+        if (!inRange<Q>(c, op.x + 1))
+            return;
+        for (int i = 0; i <= op.x; i++) {
+            c.V[i] = c.memory[dataAddr<Q>(c.I + i)];
         }
-        case 0xC000: { //CNNN - Random
-            uint8_t x = (opcode & 0x0F00) >> 8;
-            uint8_t nn = opcode & 0x00FF;
-            V[x] = (rand() & 0xFF) & nn;
-            pc += 2;
-            break;
+        if constexpr (Q::loadStoreIncrementsI)
+            c.I = dataAddr<Q>(c.I + op.x + 1);
+        c.pc += 2;
+    }
+
+    /* -------------------- XO-CHIP -------------------- */
+
+    // F000 NNNN — Load I with the 16-bit address in the next word
+    static void opF000(chip8& c, const decodedOp&) {
+        c.I = c.fetch((c.pc + 2) & 0x0FFF);
+        c.pc += 4;
+    }
+
+    // FN01 — Select the planes drawing, clearing and scrolling work on
+    static void opFN01(chip8& c, const decodedOp& op) {
+        c.planes = op.x & 3;
+        c.pc += 2;
+    }
+
+    // F002 — Load the 16-byte audio pattern from memory[I..I+15]
+    static void opF002(chip8& c, const decodedOp&) {
+        for (int i = 0; i < 16; ++i) {
+            c.audioPattern[i] = c.memory[static_cast<uint16_t>(c.I + i)];
         }
-        case 0xD000: { // DXYN — Draw sprite at (VX, VY) with height N
-            /*  Opcode format: D X Y N
-
-                X = index of register VX
-                Y = index of register VY
-                N = number of sprite rows (height)
-
-                Each sprite row is 8 pixels wide (1 byte).
-                Sprite data starts at memory[I]. */
-
-
-            // Extract X coordinate from VX
-            uint8_t x = V[(opcode & 0x0F00) >> 8];
-
-            // Extract Y coordinate from VY
-            uint8_t y = V[(opcode & 0x00F0) >> 4];
-
-            // Extract sprite height (number of rows)
-            uint8_t height = opcode & 0x000F;
-
-            // VF is the collision flag — reset it before drawing
-            V[0xF] = 0;
-
-            /*
-                Loop over each row of the sprite.
-                Each row is 1 byte = 8 horizontal pixels.
-            */
-            for (int row = 0; row < height; row++) {
-                // Read one byte of sprite data from memory
-                uint8_t spriteByte = memory[I + row];
-                /*
-                    Loop over each bit (pixel) in the sprite byte.
-                    Bit 7 is the leftmost pixel.
-                    Bit 0 is the rightmost pixel.
-                */
-                for (int col = 0; col < 8; col++) {
-                    /*
-                        Check if the current bit is set.
-
-                        0x80 = 10000000
-                        Shift right by col to test each bit.
-                    */
-                    if (spriteByte & (0x80 >> col)) {
-
-                        // Compute wrapped screen coordinates
-                        int px = (x + col) % 64;
-                        int py = (y + row) % 32;
-                        // Convert 2D position into 1D framebuffer index
-                        int index = px + (py * 64);
-                        /*
-                            Collision detection:
-                            If a pixel is already ON and we are about
-                            to toggle it OFF, set VF = 1.
-                        */
-                        if (gfx[index] == 1)
-                            V[0xF] = 1;
-                        /*
-                            XOR drawing:
-                            - 0 ^ 1 = 1  (pixel turns on)
-                            - 1 ^ 1 = 0  (pixel turns off)
-                        */
-                        gfx[index] ^= 1;
-                    }
+        c.pc += 2;
+    }
+
+    // FX3A — Set the audio pitch register to VX
+    static void opFX3A(chip8& c, const decodedOp& op) {
+        c.pitch = c.V[op.x];
+        c.pc += 2;
+    }
+
+    // 8XY8–8XYD and 8XYF were always skipped over silently
+    static void opIgnored(chip8& c, const decodedOp&) {
+        c.pc += 2;
+    }
+
+    // Unknown opcode: record it and leave PC on it
+    static void opUnknown(chip8& c, const decodedOp&) {
+        c.raiseFault(faultKind::unknownOpcode);
+    }
+
+    // Instructions that end a basic block: anything that can leave PC
+    // somewhere other than the next instruction, plus memory writes, which
+    // may rewrite the block that is running, and anything else that can
+    // fault, so a fault always stops a block at its last instruction.
+    // Judged from the opcode, since the handlers differ from one quirk
+    // profile to the next.
+    static bool endsBlock(uint16_t opcode, const decodedOp& op) {
+        if (op.handler == opUnknown)
+            return true;
+
+        switch (opcode >> 12) {
+            case 0x0: return op.handler == op00EE;   // 0NEE decodes as 00EE too
+            case 0x1: case 0x2: case 0xB:               // jumps and calls
+            case 0x3: case 0x4: case 0x5: case 0x9:     // skips
+            case 0xE:
+            case 0xD:                                   // sprite reads can fault
+                return true;
+            case 0xF: {
+                uint8_t nn = opcode & 0xFF;
+                return nn == 0x0A || nn == 0x33 || nn == 0x55 || nn == 0x65;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // Placeholder for decode cache entries that haven't been filled yet:
+    // decode the opcode at PC, remember it, then run it
+    static void opDecode(chip8& c, const decodedOp&) {
+        uint16_t addr = c.pc & 0x0FFF;
+        decodedOp& entry = c.decodeCache[addr];
+
+        entry = c.decoder(c.fetch(addr));
+        c.decodedGroups |= 1ull << (addr / 64);
+        entry.handler(c, entry);
+    }
+};
+
+template <typename Q>
+decodedOp chip8::decode(uint16_t opcode) {
+    decodedOp op;
+    op.handler = chip8Ops::opUnknown;
+    op.nnn = opcode & 0x0FFF;
+    op.x = (opcode & 0x0F00) >> 8;
+    op.y = (opcode & 0x00F0) >> 4;
+    op.n = opcode & 0x000F;
+    op.nn = opcode & 0x00FF;
+
+    switch (opcode & 0xF000) { // bitwise and for the first 4 bits of hex using the mask
+        case 0x0000:
+            switch (opcode & 0x00FF) {
+                case 0x00E0: op.handler = chip8Ops::op00E0; break;
+                case 0x00EE: op.handler = chip8Ops::op00EE; break;
+                default: break; // unknown 0NNN
+            }
+
+            // SUPER-CHIP display control
+            if constexpr (Q::superChip) {
+                if ((opcode & 0xFFF0) == 0x00C0) {
+                    op.handler = chip8Ops::op00CN;
+                } else if (opcode == 0x00FB) {
+                    op.handler = chip8Ops::op00FB;
+                } else if (opcode == 0x00FC) {
+                    op.handler = chip8Ops::op00FC;
+                } else if (opcode == 0x00FE) {
+                    op.handler = chip8Ops::op00FE;
+                } else if (opcode == 0x00FF) {
+                    op.handler = chip8Ops::op00FF;
                 }
             }
+            break;
 
-            // Move program counter to the next instruction
-            pc += 2;
+        case 0x1000: op.handler = chip8Ops::op1NNN; break;
+        case 0x2000: op.handler = chip8Ops::op2NNN; break;
+        case 0x3000: op.handler = chip8Ops::op3XNN<Q>; break;
+        case 0x4000: op.handler = chip8Ops::op4XNN<Q>; break;
+
+        case 0x5000: // 5XY0
+            if ((opcode & 0x000F) == 0)
+                op.handler = chip8Ops::op5XY0<Q>;
+
+            // XO-CHIP register range save / load
+            if constexpr (Q::xoChip) {
+                if ((opcode & 0x000F) == 2) {
+                    op.handler = chip8Ops::op5XY2<Q>;
+                } else if ((opcode & 0x000F) == 3) {
+                    op.handler = chip8Ops::op5XY3<Q>;
+                }
+            }
+            break;
 
-            // Signal the renderer that the screen needs to be redrawn
-            drawFlag = true;
+        case 0x9000: // 9XY0
+            if ((opcode & 0x000F) == 0)
+                op.handler = chip8Ops::op9XY0<Q>;
+            break;
+
+        case 0x6000: op.handler = chip8Ops::op6XNN; break;
+        case 0x7000: op.handler = chip8Ops::op7XNN; break;
 
+        case 0x8000: //ALU
+            switch (opcode & 0x000F) {
+                case 0x0: op.handler = chip8Ops::op8XY0; break;
+                case 0x1: op.handler = chip8Ops::op8XY1<Q>; break;
+                case 0x2: op.handler = chip8Ops::op8XY2<Q>; break;
+                case 0x3: op.handler = chip8Ops::op8XY3<Q>; break;
+                case 0x4: op.handler = chip8Ops::op8XY4; break;
+                case 0x5: op.handler = chip8Ops::op8XY5; break;
+                case 0x6: op.handler = chip8Ops::op8XY6<Q>; break;
+                case 0x7: op.handler = chip8Ops::op8XY7; break;
+                case 0xE: op.handler = chip8Ops::op8XYE<Q>; break;
+                default:  op.handler = chip8Ops::opIgnored; break;
+            }
             break;
-        }
-        case 0xE000: {
-            uint8_t x = (opcode & 0x0F00) >> 8;
 
-            switch (opcode & 0x00FF) {
+        case 0xA000: op.handler = chip8Ops::opANNN; break;
+        case 0xB000: op.handler = chip8Ops::opBNNN<Q>; break;
+        case 0xC000: op.handler = chip8Ops::opCXNN; break;
+        case 0xD000:
+            if (Q::superChip && (opcode & 0x000F) == 0) {
+                op.handler = chip8Ops::opDXY0<Q>;
+            } else {
+                op.handler = chip8Ops::opDXYN<Q>;
+            }
+            break;
 
-                case 0x9E: // EX9E - Skip if key in VX is pressed
-                    if (key[V[x]] != 0)
-                        pc += 4;
-                    else
-                        pc += 2;
-                    break;
-
-                case 0xA1: // EXA1 - Skip if key in VX is NOT pressed
-                    if (key[V[x]] == 0)
-                        pc += 4;
-                    else
-                        pc += 2;
-                    break;
-
-                default:
-                    std::cerr << "Unknown opcode [0xE000]: "
-                              << std::hex << opcode << "\n";
-                    break;
+        case 0xE000:
+            switch (opcode & 0x00FF) {
+                case 0x9E: op.handler = chip8Ops::opEX9E<Q>; break;
+                case 0xA1: op.handler = chip8Ops::opEXA1<Q>; break;
+                default: break; // unknown EX??
             }
             break;
-        }
-        case 0xF000: {
-            // X is the register index encoded in the opcode (FX??)
-            uint8_t x = (opcode & 0x0F00) >> 8;
 
+        case 0xF000:
             // Look at the last byte to determine the exact FX instruction
             switch (opcode & 0x00FF) {
+                case 0x07: op.handler = chip8Ops::opFX07; break;
+                case 0x0A: op.handler = chip8Ops::opFX0A; break;
+                case 0x15: op.handler = chip8Ops::opFX15; break;
+                case 0x18: op.handler = chip8Ops::opFX18; break;
+                case 0x1E: op.handler = chip8Ops::opFX1E<Q>; break;
+                case 0x29: op.handler = chip8Ops::opFX29; break;
+                case 0x33: op.handler = chip8Ops::opFX33<Q>; break;
+                case 0x55: op.handler = chip8Ops::opFX55<Q>; break;
+                case 0x65: op.handler = chip8Ops::opFX65<Q>; break;
+                default: break; // Unknown FX opcode
+            }
 
-                // FX07 — Set VX = delay timer value
-                case 0x07:
-                    V[x] = delay_timer;   // Copy delay timer into VX
-                    pc += 2;              // Move to next instruction
-                    break;
-
-                    // FX15 — Set delay timer = VX
-                case 0x15:
-                    delay_timer = V[x];   // Load delay timer from VX
-                    pc += 2;
-                    break;
-
-                    // FX18 — Set sound timer = VX
-                case 0x18:
-                    sound_timer = V[x];   // Load sound timer from VX
-                    pc += 2;
-                    break;
-
-                    // FX1E — Add VX to index register I
-                case 0x1E:
-                    I += V[x];            // Add VX to I
-
-                    // Optional compatibility behavior:
-                    // Set VF if I overflows past 0x0FFF
-                    V[0xF] = (I > 0x0FFF) ? 1 : 0;
-
-                    // Keep I within 12-bit address space
-                    I &= 0x0FFF;
-
-                    pc += 2;
-                    break;
-
-                    // FX0A — Wait for a key press, then store it in VX
-                case 0x0A: {
-                    bool keyPressed = false;
-
-                    // Check all 16 keys
-                    for (int i = 0; i < 16; i++) {
-                        if (key[i]) {     // If key i is currently pressed
-                            V[x] = i;     // Store key value in VX
-                            keyPressed = true;
-                            break;
-                        }
-                    }
-
-                    // Only advance PC if a key was pressed
-                    // Otherwise, this instruction repeats (blocks)
-                    if (keyPressed)
-                        pc += 2;
-
-                    break;
+            // XO-CHIP long load, plane select and audio
+            if constexpr (Q::xoChip) {
+                if (opcode == 0xF000) {
+                    op.handler = chip8Ops::opF000;
+                } else if ((opcode & 0x00FF) == 0x01) {
+                    op.handler = chip8Ops::opFN01;
+                } else if (opcode == 0xF002) {
+                    op.handler = chip8Ops::opF002;
+                } else if ((opcode & 0x00FF) == 0x3A) {
+                    op.handler = chip8Ops::opFX3A;
                 }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return op;
+}
+
+void chip8::setQuirks(quirkProfile profile) {
+    quirks = profile;
+
+    switch (profile) {
+        case quirkProfile::legacy: decoder = decode<legacyQuirks>; break;
+        case quirkProfile::chip8:  decoder = decode<chip8Quirks>; break;
+        case quirkProfile::schip:  decoder = decode<schipQuirks>; break;
+        case quirkProfile::xochip: decoder = decode<xochipQuirks>; break;
+    }
+
+    // Everything decoded so far used the old handlers
+    clearDecodeCache();
+    flushBlocks();
+    resolveNative();
+}
 
-                    // FX29 — Set I to the font sprite address for digit in VX
-                case 0x29:
-                    // Each font character is 5 bytes
-                    // Fontset starts at memory location 0x50
-                    I = 0x50 + (V[x] & 0x0F) * 5;
-                    pc += 2;
-                    break;
-
-                    // FX33 — Store BCD representation of VX at memory[I..I+2]
-                case 0x33:
-                    // Hundreds digit
-                    memory[I] = V[x] / 100;
-
-                    // Tens digit
-                    memory[I + 1] = (V[x] / 10) % 10;
-
-                    // Ones digit
-                    memory[I + 2] = V[x] % 10;
-
-                    pc += 2;
-                    break;
-
-                    // FX55 — Store registers V0 through VX in memory starting at I
-                case 0x55:
-                    for (int i = 0; i <= x; i++) {
-                        memory[I + i] = V[i];
-                    }
-                    pc += 2;
-                    break;
-
-                    // FX65 — Load registers V0 through VX from memory starting at I
-                case 0x65:
-                    for (int i = 0; i <= x; i++) {
-                        V[i] = memory[I + i];
-                    }
-                    pc += 2;
-                    break;
-
-                    // Unknown FX opcode
-                default:
-                    std::cerr << "Unknown FX opcode: "
-                              << std::hex << opcode << "\n";
-                    break;
+void chip8::clearDecodeCache() {
+    decodedOp empty{};
+    empty.handler = chip8Ops::opDecode;
+
+    // Only the groups something was decoded in
+    for (size_t group = 0; group < CODE_SIZE / 64; ++group) {
+        if (!(decodedGroups >> group & 1))
+            continue;
+        for (size_t i = group * 64; i < group * 64 + 64; ++i)
+            decodeCache[i] = empty;
+    }
+    decodedGroups = 0;
+
+    // Memory may have changed anywhere
+    nativeWritten = ~0ull;
+}
+
+void chip8::invalidateCode(uint16_t addr, int length) {
+    // An instruction starting one byte before the write covers it too
+    for (int i = -1; i < length; ++i) {
+        uint16_t at = (addr + i) & 0x0FFF;
+        decodeCache[at].handler = chip8Ops::opDecode;
+        nativeWritten |= 1ull << (at / 64);
+    }
+
+    // Writing over compiled code drops every block on the next dispatch
+    if (blocks) {
+        for (int i = 0; i < length; ++i) {
+            if (blocks->codeMap[(addr + i) & 0x0FFF]) {
+                blocks->dirty = true;
+                break;
             }
+        }
+    }
+}
+
+void chip8::raiseFault(faultKind kind) {
+    faulted = true;
+    stopped = true;
+    fault = kind;
+    faultingOpcode = fetch(pc & 0x0FFF);
+}
+
+const char* faultKindName(faultKind kind) {
+    switch (kind) {
+        case faultKind::none:           return "none";
+        case faultKind::unknownOpcode:  return "unknown opcode";
+        case faultKind::stackOverflow:  return "stack overflow";
+        case faultKind::stackUnderflow: return "stack underflow";
+        case faultKind::badKey:         return "bad key";
+        case faultKind::memoryRange:    return "memory out of range";
+    }
+    return "?";
+}
+
+void chip8::emulateCycle() {
+    runFor(1);
+}
+
+/* -------------------- IDLE LOOPS -------------------- */
+
+// A jump from `from` just closed a loop at PC. If a pass over the loop
+// leaves the state as it is until the delay timer ticks, stop here and
+// let runFor() skip the passes.
+void chip8::checkIdleJump(uint16_t from) {
+    uint16_t head = pc & 0x0FFF;
+    if (head == from) {
+        enterIdle(1);
+        return;
+    }
+
+    // FX07; 3XNN or 4XNN; 1NNN back to FX07: polling the delay timer. A
+    // pass reloads VX with DT and repeats the skip test on it, so it
+    // changes nothing while VX already equals DT and the test fails.
+    uint16_t load = fetch(head);
+    uint16_t test = fetch((head + 2) & 0x0FFF);
+    uint8_t x = (load >> 8) & 0xF;
+    uint8_t nn = test & 0xFF;
+
+    if ((load & 0xF0FF) != 0xF007 || ((test >> 8) & 0xF) != x || V[x] != delay_timer)
+        return;
+    if (((test >> 12) == 0x3 && V[x] != nn) || ((test >> 12) == 0x4 && V[x] == nn))
+        enterIdle(3);
+}
+
+/* -------------------- SCHEDULER -------------------- */
+
+/*
+    Time is counted in CPU cycles, never wall-clock time. Timer tick k
+    (counted from the last speed change) lands on cycle
+    ceil(k * cpuHz / 60), so the timers run at exactly 60 Hz of emulated
+    time whatever the CPU speed, and a run is the same on every machine.
+*/
+
+void chip8::setCpuHz(uint32_t hz) {
+    cpuHz = hz ? hz : 1;
+
+    // Restart the tick sequence from here at the new speed
+    tickBaseCycle = cycleCount;
+    ticksSinceBase = 0;
+    scheduleNextTick();
+}
+
+void chip8::scheduleNextTick() {
+    nextTickCycle = tickCycle(tickBaseCycle, ticksSinceBase + 1, cpuHz);
+}
+
+// Every timer tick that is due by the current cycle
+void chip8::catchUpTimers() {
+    while (cycleCount >= nextTickCycle) {
+        tickTimers();
+        ++ticksSinceBase;
+        scheduleNextTick();
+#ifdef CHIP8_PROFILE
+        prof->endFrame();
+#endif
+    }
+}
+
+uint64_t chip8::runFor(uint64_t cycles) {
+    uint64_t done = 0;
+
+    // An idle loop found by a single step outside runFor() may be stale
+    stopped = faulted;
+    if (dbg && dbg->isPaused())
+        return 0;
+
+    while (done < cycles && !faulted) {
+        catchUpTimers();
+
+        // Run up to the next timer tick without looking at the timers
+        uint64_t slice = nextTickCycle - cycleCount;
+        if (slice > cycles - done)
+            slice = cycles - done;
+
+        uint64_t ran = execute(slice);
+        bool paused = false;
+
+        // PC is in an idle loop. Timers only tick and keys only change
+        // between slices, so every pass up to the slice's end leaves the
+        // state as it is: count them as run. The leftover part of a pass
+        // runs normally. Under a debugger the passes run one by one, and
+        // stopping means the debugger paused.
+        if (stopped && !faulted) {
+            if (dbg) {
+                paused = dbg->isPaused();
+            } else {
+                uint64_t skip = (slice - ran) / idleLength * idleLength;
+                ran += skip;
+                idleCycles += skip;
+            }
+            stopped = false;
+        }
+        cycleCount += ran;
+        done += ran;
+        if (paused)
+            break;
+    }
+
+    // A tick that falls on the last cycle belongs to this call
+    catchUpTimers();
+    return done;
+}
+
+uint64_t chip8::runFrame() {
+    return runFor(cyclesUntilFrame());
+}
+
+/* -------------------- DISPATCH LOOPS -------------------- */
+
+// The other debugger policy (see debugger.hpp), for runs without one:
+// both hooks are constant true, so the loops below compile to exactly
+// the plain fetch-execute loop
+struct noDebugger {
+    bool before(chip8&) { return true; }
+    bool after(chip8&) { return true; }
+};
+
+template <typename D>
+uint64_t chip8::interpret(D& debug, uint64_t cycles) {
+    uint64_t done = 0;
+    while (done < cycles && !stopped) {
+        if (!debug.before(*this)) {
+            stopped = true;
+            break;
+        }
 
+        // Fetch 2-byte opcode, decode & execute
+        PROFILE_STEP();
+        COVERAGE_STEP();
+        decodedOp op = decoder(fetch(pc & 0x0FFF));
+        op.handler(*this, op);
+        ++done;
+
+        if (!debug.after(*this))
+            stopped = true;
+    }
+    return done;
+}
+
+template <typename D>
+uint64_t chip8::runCached(D& debug, uint64_t cycles) {
+    uint64_t done = 0;
+    while (done < cycles && !stopped) {
+        if (!debug.before(*this)) {
+            stopped = true;
             break;
         }
 
+        // Execute straight from the decode cache
+        PROFILE_STEP();
+        COVERAGE_STEP();
+        const decodedOp& op = decodeCache[pc & 0x0FFF];
+        op.handler(*this, op);
+        ++done;
 
+        if (!debug.after(*this))
+            stopped = true;
+    }
+    return done;
+}
 
+uint64_t chip8::execute(uint64_t cycles) {
+    if (dbg) {
+        if (mode == dispatchMode::interpreter)
+            return interpret(*dbg, cycles);
+        return runCached(*dbg, cycles);
+    }
 
+    noDebugger none;
+    switch (mode) {
+        case dispatchMode::interpreter: return interpret(none, cycles);
+        case dispatchMode::cached:      return runCached(none, cycles);
+        case dispatchMode::block:       return runBlocks(cycles);
+        case dispatchMode::native:      return runNative(cycles);
+    }
+    return 0;
+}
 
-            // TODO: Implement other opcodes
+/* -------------------- BASIC BLOCKS -------------------- */
 
-        default:
-            std::cerr << "Unknown opcode: " << std::hex << opcode << "\n";
+// Longest straight run compiled into one block
+static const size_t MAX_BLOCK_LENGTH = 64;
+
+void chip8::setDispatchMode(dispatchMode m) {
+    mode = m;
+    if (mode == dispatchMode::block && !blocks)
+        blocks = std::make_unique<blockCache>();
+    resolveNative();
+}
+
+void chip8::flushBlocks() {
+    if (!blocks || blocks->owned.empty())
+        return;
+
+    std::memset(blocks->at, 0, sizeof(blocks->at));
+    std::memset(blocks->codeMap, 0, sizeof(blocks->codeMap));
+    blocks->owned.clear();
+    blocks->last = nullptr;
+    blocks->dirty = false;
+}
+
+codeBlock* chip8::compileBlock(uint16_t start) {
+    auto block = std::make_unique<codeBlock>();
+    block->start = start;
+
+    uint16_t addr = start;
+    while (true) {
+        uint16_t opcode = fetch(addr);
+        decodedOp op = decoder(opcode);
+        block->ops.push_back(op);
+
+        blocks->codeMap[addr] = true;
+        blocks->codeMap[(addr + 1) & 0x0FFF] = true;
+        addr = (addr + 2) & 0x0FFF;
+
+        // F000 NNNN reads its second word when it runs; step over it
+        if (op.handler == chip8Ops::opF000)
+            addr = (addr + 2) & 0x0FFF;
+
+        // Stop at control flow, at the length cap, and at the end of memory
+        if (chip8Ops::endsBlock(opcode, op) || block->ops.size() == MAX_BLOCK_LENGTH || addr < start)
             break;
     }
 
-// Update timers
-    if (delay_timer > 0)
-        --delay_timer;
+    codeBlock* raw = block.get();
+    blocks->at[start] = raw;
+    blocks->owned.push_back(std::move(block));
+    return raw;
+}
+
+codeBlock* chip8::nextBlock(codeBlock* prev) {
+    uint16_t addr = pc & 0x0FFF;
 
-    if (sound_timer > 0)
-        --sound_timer;
+    // Follow a link made the last time this block exited to the same place
+    if (prev) {
+        if (prev->next[0] && prev->nextPc[0] == addr)
+            return prev->next[0];
+        if (prev->next[1] && prev->nextPc[1] == addr)
+            return prev->next[1];
+    }
+
+    codeBlock* block = blocks->at[addr];
+    if (!block)
+        block = compileBlock(addr);
 
+    // Link it: fall-through and taken exits fill the two slots, anything
+    // beyond that (00EE, BNNN) keeps replacing the second one
+    if (prev) {
+        int slot = prev->next[0] ? 1 : 0;
+        prev->next[slot] = block;
+        prev->nextPc[slot] = addr;
+    }
+    return block;
+}
+
+uint64_t chip8::runBlocks(uint64_t cycles) {
+    uint64_t done = 0;
+
+    // Chaining carries over between calls, since runFor slices execution
+    // at every timer tick
+    codeBlock* prev = blocks->last;
+
+    while (done < cycles && !stopped) {
+        if (blocks->dirty) {
+            flushBlocks();
+            prev = nullptr;
+        }
+
+        codeBlock* block = nextBlock(prev);
+        const decodedOp* op = block->ops.data();
+        size_t length = block->ops.size();
+
+        // Not enough budget left for the whole block: run its head, and
+        // the next call picks up from the middle
+        if (length > cycles - done) {
+            length = static_cast<size_t>(cycles - done);
+            prev = nullptr;
+        } else {
+            prev = block;
+        }
+
+        for (size_t i = 0; i < length; ++i) {
+            PROFILE_STEP();
+            COVERAGE_STEP();
+            op[i].handler(*this, op[i]);
+        }
+
+        done += length;
+    }
+
+    blocks->last = prev;
+    return done;
+}
+
+/* -------------------- NATIVE CODE -------------------- */
+
+void chip8::resolveNative() {
+    native = mode == dispatchMode::native ? findAotModule(romHash, quirks) : nullptr;
+    nativeWritten = ~0ull;
+    nativeChangedPages = 0;
+    nativeChanged.assign(native ? native->blockCount : 0, 0);
+}
+
+// Compare every block on a page written since the last look with the ROM
+// image, then answer for `block`. Data kept next to code only costs this
+// once after each write; a block that was written over stays off until
+// its bytes match again.
+bool chip8::nativeRecheck(size_t block) {
+    if (nativeWritten) {
+        const uint8_t* image = native->image;
+        nativeChangedPages = 0;
+
+        for (size_t i = 0; i < native->blockCount; ++i) {
+            const aotBlock& b = native->blocks[i];
+            if (b.pages & nativeWritten)
+                nativeChanged[i] = std::memcmp(memory + b.start, image + (b.start - 0x200), b.bytes) != 0;
+            if (nativeChanged[i])
+                nativeChangedPages |= b.pages;
+        }
+        nativeWritten = 0;
+    }
+    return !nativeChanged[block];
+}
+
+uint64_t chip8::runNative(uint64_t cycles) {
+    uint64_t done = 0;
+
+    while (done < cycles && !stopped) {
+        // Translated code runs until it reaches an address without a
+        // block, a block that was written over or one the budget doesn't
+        // cover in full (a block only faults on its last instruction, like
+        // the core's own blocks). The profiler and coverage hooks want
+        // every instruction, so those builds never enter it.
+#if !defined(CHIP8_PROFILE) && !defined(CHIP8_COVERAGE)
+        if (native) {
+            done += native->run(*this, cycles - done);
+            if (done >= cycles || stopped)
+                break;
+        }
+#endif
+
+        // Then one instruction from the decode cache
+        PROFILE_STEP();
+        COVERAGE_STEP();
+        const decodedOp& op = decodeCache[pc & 0x0FFF];
+        op.handler(*this, op);
+        ++done;
+    }
+    return done;
 }
@@ -5,17 +5,109 @@
 #ifndef CHIP8_EMULATOR_CHIP8_HPP
 #define CHIP8_EMULATOR_CHIP8_HPP
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
+#include "quirks.hpp"
+
+#ifdef CHIP8_PROFILE
+#include "profiler.hpp"
+#endif
+
+#ifdef CHIP8_COVERAGE
+// Called with the PC of every instruction, before it runs. Fuzzing builds
+// (-DCHIP8_FUZZ=ON) only; the fuzz harness defines it.
+void chip8CoverageStep(uint16_t pc);
+#endif
+
+class chip8;
+struct codeBlock;
+struct blockCache;
+struct aotModule;
+class debugger;
+
+// A predecoded instruction: the handler that executes it plus its operands
+struct decodedOp {
+    void (*handler)(chip8&, const decodedOp&);
+    uint16_t nnn;   // lowest 12 bits (address)
+    uint8_t x;      // second nibble (register)
+    uint8_t y;      // third nibble (register)
+    uint8_t n;      // lowest nibble
+    uint8_t nn;     // lowest byte
+};
+
+// How the core dispatches instructions
+enum class dispatchMode {
+    interpreter, // fetch and decode the opcode at PC on every cycle
+    cached,      // run from the per-address decode cache
+    block,       // run compiled basic blocks chained to their successors
+    native       // run the ROM's code translated ahead of time (chip8_aot, see
+                 // aot.hpp) where it was linked in, the decode cache elsewhere
+};
+
+// Why the core stopped (chip8::hasFault()). These are the places a ROM
+// would otherwise run into undefined behaviour.
+enum class faultKind : uint8_t {
+    none,
+    unknownOpcode,
+    stackOverflow,      // 2NNN with all 16 stack levels in use
+    stackUnderflow,     // 00EE with an empty stack
+    badKey,             // EX9E / EXA1 with VX above 0xF
+    memoryRange         // a classic-profile read or write runs past 0xFFF
+};
+
+const char* faultKindName(faultKind kind);
+
+// Address space. Classic profiles see the first 4 KiB; XO-CHIP data can
+// live anywhere in 64 KiB. Code always runs from the first 4 KiB, since
+// PC is only ever set from 12-bit addresses.
+static constexpr size_t MEMORY_SIZE = 0x10000;
+static constexpr size_t CODE_SIZE = 0x1000;
+
+// Save state layout. Fixed size, little-endian. Memory and the display
+// rows sit at fixed offsets so snapshots can be diffed piece by piece.
+struct saveStateLayout {
+    static constexpr uint16_t VERSION = 3;
+
+    static constexpr size_t HEADER = 0;                         // "C8SS", version, reserved
+    static constexpr size_t MEMORY = 8;                         // 64 KiB
+    static constexpr size_t GFX = MEMORY + MEMORY_SIZE;         // 2 planes × 64 rows × 2 words × 8 bytes
+    static constexpr size_t ROW_SIZE = 16;
+    static constexpr size_t PLANE_SIZE = 64 * ROW_SIZE;
+    static constexpr size_t CPU = GFX + 2 * PLANE_SIZE;         // registers, stack, timers, keys, scheduler,
+                                                                // resolution, planes, audio
+    static constexpr size_t SIZE = CPU + 131;
+};
 
 class chip8 {
 
+    friend struct chip8Ops;
+    friend class lockstepBatch;
+    friend class debugger;
+
+    // Code generated by chip8_aot, one specialization per translated ROM
+    template <typename Tag>
+    friend struct aotCode;
+
 private:
-    // Current opcode
-    uint16_t opcode;
+    // Memory (64K, see MEMORY_SIZE)
+    uint8_t memory[MEMORY_SIZE];
+
+    // Bit p set = 1 KiB page p may differ from power-on memory (zeros plus
+    // the font, so page 0 always counts). reset() and copyFrom() only
+    // touch these pages.
+    static constexpr size_t MEMORY_PAGE = 1024;
+    uint64_t livePages;
 
-    // Memory (4K)
-    uint8_t memory[4096];
+    // Writes that wrap past the top of memory land in page 0
+    void markLive(uint16_t addr, int length) {
+        size_t last = (addr + length - 1) / MEMORY_PAGE;
+        for (size_t page = addr / MEMORY_PAGE; page <= last && page < 64; ++page)
+            livePages |= 1ull << page;
+    }
 
     // CPU registers (V0–VF, VF is flag)
     uint8_t V[16];
@@ -26,14 +118,35 @@ private:
     // Program counter
     uint16_t pc;
 
-    // Graphics (64 × 32 monochrome display)
-    uint8_t gfx[64 * 32];
+    // Graphics: 64 × 32, or 128 × 64 in SUPER-CHIP hi-res, in two
+    // bitplanes (XO-CHIP; the other profiles only ever use plane 0).
+    // Each plane is stored on its own, so drawing to one plane is the same
+    // word-at-a-time work whether or not the other exists.
+    // Each row is two uint64_t words, left then right, and bit 63 of a
+    // word is its leftmost pixel. Lo-res uses the left word of rows 0–31.
+    uint64_t gfx[2][64][2];
+    bool hires;
+    uint8_t planes;       // FN01: bit p set = draws, clears and scrolls touch plane p
     bool drawFlag;
 
+    void screenChanged() { drawFlag = true; }
+
+    // 00FE / 00FF: switching resolution clears the screen
+    void setResolution(bool hi) {
+        hires = hi;
+        std::memset(gfx, 0, sizeof(gfx));
+        screenChanged();
+    }
+
     // Timers
     uint8_t delay_timer;
     uint8_t sound_timer;
 
+    // XO-CHIP audio: a 128-bit 1-bit sample loop (F002) played at a rate
+    // set by the pitch register (FX3A) while the sound timer runs
+    uint8_t audioPattern[16];
+    uint8_t pitch;
+
     // Stack (16 levels) and stack pointer
     uint16_t stack[16];
     uint16_t sp;
@@ -41,18 +154,237 @@ private:
     // Keypad (HEX-based, 0x0–0xF)
     uint8_t key[16];
 
+    // Per-instance random state for CNNN (xorshift64*), so instances
+    // running on different threads never share anything
+    uint64_t rngState;
+
+    // FNV-1a of the loaded ROM image
+    uint64_t romHash;
+
+    // Set when an instruction can't run (see faultKind); PC stays on it
+    bool faulted;
+    faultKind fault;
+    uint16_t faultingOpcode;
+
+    // Idle loops: set with faulted, or when PC sits in a loop that can't
+    // change anything before the next timer tick or key change, which
+    // ends the dispatch loop so runFor() can skip whole passes of it
+    bool stopped;
+    uint8_t idleLength;       // instructions per pass
+    bool idleSkipping;
+    uint64_t idleCycles;      // cycles skipped so far
+
+    void enterIdle(uint8_t length) { idleLength = length; stopped = true; }
+    void checkIdleJump(uint16_t from);
+
+    // Decode cache, one entry per address. Entries start out pointing at a
+    // handler that decodes and fills them in; memory writes reset them.
+    dispatchMode mode;
+    decodedOp decodeCache[CODE_SIZE];
+    uint64_t decodedGroups;   // bit g set = addresses 64g..64g+63 may hold decoded entries
+
+    // Quirk profile, baked into the handlers decode picks
+    quirkProfile quirks;
+    decodedOp (*decoder)(uint16_t opcode);
+
+    uint16_t fetch(uint16_t addr) const {
+        return memory[addr] << 8 | memory[(addr + 1) & 0x0FFF];
+    }
+    template <typename Q>
+    static decodedOp decode(uint16_t opcode);
+    void clearDecodeCache();
+    void invalidateCode(uint16_t addr, int length);
+
+    // Scheduler: virtual time in CPU cycles, timers tick at 60 Hz of it
+    uint32_t cpuHz;
+    uint64_t cycleCount;
+    uint64_t tickBaseCycle;   // cycle of the last speed change
+    uint64_t ticksSinceBase;  // timer ticks since then
+    uint64_t nextTickCycle;
+
+    // Cycle of the k-th timer tick after `base` at `hz`
+    static uint64_t tickCycle(uint64_t base, uint64_t k, uint32_t hz) { return base + (k * hz + 59) / 60; }
+
+    void scheduleNextTick();
+    void catchUpTimers();
+    uint64_t execute(uint64_t cycles);
+
+    // One instruction at a time, decoding each or from the decode cache.
+    // The debugger policy D sees every instruction: before() and after()
+    // return false to stop there. Release runs use noDebugger, whose hooks
+    // compile away (see DISPATCH LOOPS in chip8.cpp).
+    template <typename D>
+    uint64_t interpret(D& debug, uint64_t cycles);
+    template <typename D>
+    uint64_t runCached(D& debug, uint64_t cycles);
+
+    // Attached debugger (not owned), or nullptr
+    debugger* dbg;
+
+    // Basic blocks (block mode only, allocated on first use)
+    std::unique_ptr<blockCache> blocks;
+
+    void flushBlocks();
+    codeBlock* compileBlock(uint16_t start);
+    codeBlock* nextBlock(codeBlock* prev);
+    uint64_t runBlocks(uint64_t cycles);
+
+    // Ahead-of-time translated code for this ROM and profile (native mode
+    // only). Blocks are checked against the ROM image they were translated
+    // from when 64-byte code pages they sit in were written since the last
+    // look; the verdict is kept per block until the next write.
+    const aotModule* native;
+    uint64_t nativeWritten;
+    uint64_t nativeChangedPages;     // pages holding blocks that no longer match
+    std::vector<uint8_t> nativeChanged;
+
+    void resolveNative();
+    bool nativeRecheck(size_t block);
+    uint64_t runNative(uint64_t cycles);
+
+    // Called by generated code on entering a block
+    bool nativeIntact(size_t block, uint64_t pages) {
+        return !((nativeWritten | nativeChangedPages) & pages) || nativeRecheck(block);
+    }
+
+    void tickTimers() {
+        if (delay_timer > 0)
+            --delay_timer;
+
+        if (sound_timer > 0)
+            --sound_timer;
+    }
+
+    // xorshift64* step over a generator state (see seed())
+    static uint8_t nextRandom(uint64_t& state);
+    uint8_t nextRandom() { return nextRandom(rngState); }
+    void raiseFault(faultKind kind);
+    void romLoaded(size_t size, uint64_t hash);
+
+#ifdef CHIP8_PROFILE
+    std::unique_ptr<profiler> prof;
+#endif
+
 public:
     chip8();
+    ~chip8();
+
+    // Back to the power-on state, as if newly constructed: memory (font
+    // reloaded), display, registers, stack, timers, keys and faults are
+    // cleared, the seed goes back to 0 and the speed to 600 Hz, the
+    // dispatch mode to cached (dropping native code), and a debugger is
+    // detached. The quirk profile stays. Cheaper than a new instance: only
+    // memory that was written gets cleared, and decoded code stays warm
+    // elsewhere.
+    void reset();
+
+    // Become an exact copy of `other` (the decode cache, profiler and
+    // debugger stay this instance's own). Copies the registers, display
+    // and the memory pages either instance has written, and keeps this instance's
+    // decoded code wherever it matches. See instancePool.
+    void copyFrom(const chip8& other);
     void setKey(uint8_t k, bool pressed) { key[k] = pressed; }
+    void setKeys(uint16_t mask);
+    void seed(uint64_t s);
 
 
+    // ROM images go straight into memory at 0x200 with one copy. The
+    // three-argument form takes a hash computed earlier (see romLibrary).
     void loadROM(const std::string& filename);
+    void loadROM(const uint8_t* data, size_t size);
+    void loadROM(const uint8_t* data, size_t size, uint64_t hash);
+
+    // FNV-1a of a ROM image, as reported by getROMHash()
+    static uint64_t hashROM(const uint8_t* data, size_t size);
     void emulateCycle();
 
-    // Display access
+    // Run up to `cycles` instructions, stopping early on a fault.
+    // Returns the number of cycles actually run.
+    uint64_t runFor(uint64_t cycles);
+
+    // Run up to and including the next 60 Hz timer tick (one frame)
+    uint64_t runFrame();
+    uint64_t cyclesUntilFrame() const { return nextTickCycle - cycleCount; }
+
+    // Instructions per second; the timers stay at 60 Hz either way
+    void setCpuHz(uint32_t hz);
+    uint32_t getCpuHz() const { return cpuHz; }
+    uint64_t getCycleCount() const { return cycleCount; }
+
+    // Skip spin loops (1NNN to itself, FX0A with no key down, FX07 /
+    // 3XNN / 1NNN polling the delay timer) instead of running them. On by
+    // default; the state after every runFor() is the same either way.
+    void setIdleSkipping(bool on) { idleSkipping = on; }
+    bool getIdleSkipping() const { return idleSkipping; }
+    uint64_t getIdleCycles() const { return idleCycles; }
+
+    void setDispatchMode(dispatchMode m);
+    dispatchMode getDispatchMode() const { return mode; }
+
+    // Native mode found translated code for the loaded ROM and profile
+    bool hasNativeCode() const { return native != nullptr; }
+
+    // Run every instruction past `d` (see debugger.hpp), nullptr to stop.
+    // Block and native modes run from the decode cache meanwhile, and idle
+    // loops run in full. The debugger must outlive the attachment; reset()
+    // detaches it.
+    void attachDebugger(debugger* d) { dbg = d; }
+    debugger* getDebugger() const { return dbg; }
+
+    // Select the interpreter behaviour the ROM was written for (see quirks.hpp)
+    void setQuirks(quirkProfile profile);
+    quirkProfile getQuirks() const { return quirks; }
+
+    // Save states (see saveStateLayout). loadState throws on a bad or
+    // mismatched state and leaves the emulator untouched.
+    void saveState(std::vector<uint8_t>& out) const;
+    std::vector<uint8_t> saveState() const;
+    void loadState(const uint8_t* data, size_t size);
+    void loadState(const std::vector<uint8_t>& data) { loadState(data.data(), data.size()); }
+
+    // Compare all machine state (lockstep testing)
+    bool stateEquals(const chip8& other) const;
+
+    // Display access. getPlaneRows() is 64 rows of two words (see gfx);
+    // only the top-left getDisplayWidth() × getDisplayHeight() is visible.
+    // A pixel's colour is its plane 0 bit plus twice its plane 1 bit.
     bool shouldDraw() const { return drawFlag; }
     void resetDrawFlag() { drawFlag = false; }
-    uint8_t* getDisplay() { return gfx; }
+    bool isHires() const { return hires; }
+    int getDisplayWidth() const { return hires ? 128 : 64; }
+    int getDisplayHeight() const { return hires ? 64 : 32; }
+    const uint64_t* getDisplayRows() const { return &gfx[0][0][0]; }
+    const uint64_t* getPlaneRows(int plane) const { return &gfx[plane][0][0]; }
+    void getDisplay(uint8_t* out) const; // unpack to width * height bytes, one colour (0–3) per pixel
+    uint64_t displayHash() const;
+
+    uint64_t getROMHash() const { return romHash; }
+
+    // CPU state access (headless runner, tooling)
+    const uint8_t* getMemory() const { return memory; }
+    const uint8_t* getRegisters() const { return V; }
+    uint16_t getIndex() const { return I; }
+    uint16_t getPC() const { return pc; }
+    uint16_t getSP() const { return sp; }
+    uint8_t getDelayTimer() const { return delay_timer; }
+    uint8_t getSoundTimer() const { return sound_timer; }
+
+    // Audio: the 16-byte pattern, played most significant bit first, and
+    // its rate in bits per second (4000 × 2^((pitch − 64) / 48))
+    const uint8_t* getAudioPattern() const { return audioPattern; }
+    uint8_t getPitch() const { return pitch; }
+    double getAudioRate() const;
+
+    // Fault reporting (replaces the old std::cerr prints)
+    bool hasFault() const { return faulted; }
+    faultKind getFault() const { return fault; }
+    uint16_t faultOpcode() const { return faultingOpcode; }
+
+#ifdef CHIP8_PROFILE
+    // Only in profiling builds (-DCHIP8_PROFILE=ON)
+    profiler& getProfiler() { return *prof; }
+    const profiler& getProfiler() const { return *prof; }
+#endif
 
 
 };
@@ -0,0 +1,443 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "debugger.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+debugger::debugger(size_t traceLength) : trace(traceLength) {
+}
+
+/* -------------------- HOOKS -------------------- */
+
+bool debugger::before(chip8& c) {
+    if (paused)
+        return false;
+
+    uint16_t pc = c.pc & 0x0FFF;
+    if (breakpointCount && hasBreakpoint(pc) && !resuming) {
+        halt(debugStop::breakpoint, pc);
+        return false;
+    }
+    resuming = false;
+
+    uint16_t opcode = c.fetch(pc);
+    if (!trace.empty()) {
+        traceEntry& entry = trace[traceNext];
+        entry.pc = pc;
+        entry.opcode = opcode;
+        entry.I = c.I;
+        std::memcpy(entry.V, c.V, sizeof(entry.V));
+
+        if (++traceNext == trace.size())
+            traceNext = 0;
+        if (traceUsed < trace.size())
+            ++traceUsed;
+    }
+
+    // Stores are checked before they run, against the I they will use
+    if (watchCount) {
+        int length = 0;
+        uint16_t target = storeTarget(c, opcode, length);
+        for (int i = 0; i < length; ++i) {
+            uint16_t addr = static_cast<uint16_t>(target + i);
+            if (isWatched(addr)) {
+                watchHit = true;
+                watchAddr = addr;
+                stopPc = pc;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool debugger::after(chip8& c) {
+    // A store that faulted wrote nothing, and the fault is the stop
+    if (watchHit) {
+        watchHit = false;
+        if (!c.faulted) {
+            halt(debugStop::watchpoint, stopPc);
+            stopAddr = watchAddr;
+            return false;
+        }
+    }
+
+    if (stepsLeft && --stepsLeft == 0) {
+        halt(debugStop::step, c.pc & 0x0FFF);
+        return false;
+    }
+    return true;
+}
+
+void debugger::halt(debugStop reason, uint16_t pc) {
+    paused = true;
+    stop = reason;
+    stopPc = pc;
+    stopReported = false;
+    stepsLeft = 0;
+}
+
+// First address and length of what `opcode` writes to memory, if anything
+uint16_t debugger::storeTarget(const chip8& c, uint16_t opcode, int& length) const {
+    int x = (opcode >> 8) & 0xF;
+    int y = (opcode >> 4) & 0xF;
+
+    if ((opcode & 0xF0FF) == 0xF033) {
+        length = 3;
+    } else if ((opcode & 0xF0FF) == 0xF055) {
+        length = x + 1;
+    } else if (c.quirks == quirkProfile::xochip && (opcode & 0xF00F) == 0x5002) {
+        length = (x > y ? x - y : y - x) + 1;
+    } else {
+        length = 0;
+    }
+    return c.I;
+}
+
+/* -------------------- CONTROL -------------------- */
+
+void debugger::setBreakpoint(uint16_t addr, bool on) {
+    addr &= 0x0FFF;
+    if (hasBreakpoint(addr) == on)
+        return;
+
+    breakpoints[addr / 64] ^= 1ull << (addr % 64);
+    if (on)
+        ++breakpointCount;
+    else
+        --breakpointCount;
+}
+
+std::vector<uint16_t> debugger::getBreakpoints() const {
+    std::vector<uint16_t> list;
+    for (uint16_t addr = 0; addr < CODE_SIZE; ++addr) {
+        if (hasBreakpoint(addr))
+            list.push_back(addr);
+    }
+    return list;
+}
+
+void debugger::setWatchpoint(uint16_t addr, uint16_t length, bool on) {
+    for (uint32_t i = 0; i < length; ++i) {
+        uint16_t at = static_cast<uint16_t>(addr + i);
+        if (isWatched(at) == on)
+            continue;
+
+        watched[at / 64] ^= 1ull << (at % 64);
+        if (on)
+            ++watchCount;
+        else
+            --watchCount;
+    }
+}
+
+void debugger::pause() {
+    if (paused)
+        return;
+
+    paused = true;
+    stop = debugStop::pause;
+    stopReported = false;
+    stepsLeft = 0;
+}
+
+void debugger::resume() {
+    paused = false;
+    resuming = true;
+    stop = debugStop::none;
+    stepsLeft = 0;
+}
+
+void debugger::step(uint64_t count) {
+    resume();
+    stepsLeft = count ? count : 1;
+}
+
+bool debugger::takeStop() {
+    if (stopReported)
+        return false;
+    stopReported = true;
+    return true;
+}
+
+std::string debugger::describeStop(const chip8& c) const {
+    std::string at = listing(c, c.pc & 0x0FFF, 1);
+    char buf[64];
+
+    switch (stop) {
+        case debugStop::none:
+            return "running\n";
+        case debugStop::pause:
+            return "paused at " + at;
+        case debugStop::breakpoint:
+            return "breakpoint at " + at;
+        case debugStop::step:
+            return "stepped to " + at;
+        case debugStop::watchpoint:
+            std::snprintf(buf, sizeof(buf), "watchpoint %04X written by %03X, now at ", stopAddr, stopPc);
+            return buf + at;
+    }
+    return at;
+}
+
+const traceEntry& debugger::traceAt(size_t i) const {
+    if (i >= traceUsed)
+        throw std::runtime_error("Trace entry out of range");
+
+    size_t oldest = traceUsed < trace.size() ? 0 : traceNext;
+    return trace[(oldest + i) % trace.size()];
+}
+
+/* -------------------- COMMANDS -------------------- */
+
+static uint16_t parseAddress(const std::string& text) {
+    size_t used = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(text, &used, 16);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != text.size() || value > 0xFFFF)
+        throw std::runtime_error("Bad address: " + text);
+    return static_cast<uint16_t>(value);
+}
+
+static uint64_t parseCount(const std::string& text) {
+    size_t used = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &used, 10);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used != text.size())
+        throw std::runtime_error("Bad count: " + text);
+    return value;
+}
+
+std::string debugger::listing(const chip8& c, uint16_t addr, size_t count) {
+    std::string out;
+    char buf[96];
+
+    for (size_t i = 0; i < count; ++i) {
+        addr &= 0x0FFF;
+        uint16_t opcode = c.fetch(addr);
+
+        // F000 NNNN is the one 4-byte instruction
+        if (c.quirks == quirkProfile::xochip && opcode == 0xF000) {
+            uint16_t next = c.fetch((addr + 2) & 0x0FFF);
+            std::snprintf(buf, sizeof(buf), "%03X  %04X %04X  %s\n", addr, opcode, next,
+                          disassemble(opcode, c.quirks, next).c_str());
+            addr += 4;
+        } else {
+            std::snprintf(buf, sizeof(buf), "%03X  %04X  %s\n", addr, opcode,
+                          disassemble(opcode, c.quirks).c_str());
+            addr += 2;
+        }
+        out += buf;
+    }
+    return out;
+}
+
+std::string debugger::command(chip8& c, const std::string& line) {
+    std::istringstream in(line);
+    std::string name;
+    std::vector<std::string> args;
+    in >> name;
+    for (std::string arg; in >> arg;)
+        args.push_back(arg);
+
+    std::string out;
+    char buf[128];
+
+    if (name.empty()) {
+        return out;
+    } else if (name == "step" || name == "s") {
+        step(args.empty() ? 1 : parseCount(args[0]));
+    } else if (name == "continue" || name == "c") {
+        resume();
+    } else if (name == "pause" || name == "p") {
+        pause();
+    } else if (name == "break" || name == "b") {
+        if (args.empty()) {
+            for (uint16_t addr : getBreakpoints())
+                out += listing(c, addr, 1);
+            if (out.empty())
+                out = "no breakpoints\n";
+        } else {
+            for (const std::string& arg : args)
+                setBreakpoint(parseAddress(arg));
+        }
+    } else if (name == "delete") {
+        if (args.empty())
+            throw std::runtime_error("delete needs an address");
+        for (const std::string& arg : args)
+            setBreakpoint(parseAddress(arg), false);
+    } else if (name == "watch" || name == "w" || name == "unwatch") {
+        if (args.empty())
+            throw std::runtime_error(name + " needs an address");
+        uint64_t length = args.size() > 1 ? parseCount(args[1]) : 1;
+        setWatchpoint(parseAddress(args[0]), static_cast<uint16_t>(std::min<uint64_t>(length, 0xFFFF)),
+                      name != "unwatch");
+    } else if (name == "dump" || name == "r") {
+        std::snprintf(buf, sizeof(buf), "PC %03X  I %03X  SP %u  DT %02X  ST %02X  cycle %llu\n",
+                      c.pc, c.I, c.sp, c.delay_timer, c.sound_timer,
+                      static_cast<unsigned long long>(c.cycleCount));
+        out += buf;
+        for (int i = 0; i < 16; ++i) {
+            std::snprintf(buf, sizeof(buf), "V%X %02X%s", i, c.V[i], i % 8 == 7 ? "\n" : "  ");
+            out += buf;
+        }
+        if (c.sp) {
+            out += "stack";
+            for (int i = 0; i < c.sp; ++i) {
+                std::snprintf(buf, sizeof(buf), " %03X", c.stack[i]);
+                out += buf;
+            }
+            out += "\n";
+        }
+        if (c.faulted) {
+            std::snprintf(buf, sizeof(buf), "fault: %s (opcode %04X)\n", faultKindName(c.fault), c.faultingOpcode);
+            out += buf;
+        }
+    } else if (name == "mem" || name == "m") {
+        if (args.empty())
+            throw std::runtime_error("mem needs an address");
+        uint16_t addr = parseAddress(args[0]);
+        uint64_t length = args.size() > 1 ? parseCount(args[1]) : 64;
+
+        for (uint64_t i = 0; i < length && i < MEMORY_SIZE; i += 16) {
+            std::snprintf(buf, sizeof(buf), "%04X ", static_cast<uint16_t>(addr + i));
+            out += buf;
+            for (uint64_t j = i; j < i + 16 && j < length; ++j) {
+                std::snprintf(buf, sizeof(buf), " %02X", c.memory[static_cast<uint16_t>(addr + j)]);
+                out += buf;
+            }
+            out += "\n";
+        }
+    } else if (name == "trace" || name == "t") {
+        size_t count = args.empty() ? 16 : static_cast<size_t>(parseCount(args[0]));
+        size_t first = traceUsed > count ? traceUsed - count : 0;
+
+        for (size_t i = first; i < traceUsed; ++i) {
+            const traceEntry& entry = traceAt(i);
+            std::snprintf(buf, sizeof(buf), "%03X  %04X  %-18s I=%03X ", entry.pc, entry.opcode,
+                          disassemble(entry.opcode, c.quirks).c_str(), entry.I);
+            out += buf;
+            for (uint8_t v : entry.V) {
+                std::snprintf(buf, sizeof(buf), " %02X", v);
+                out += buf;
+            }
+            out += "\n";
+        }
+    } else if (name == "disasm" || name == "l") {
+        uint16_t addr = args.empty() ? c.pc : parseAddress(args[0]);
+        size_t count = args.size() > 1 ? static_cast<size_t>(parseCount(args[1])) : 16;
+        out = listing(c, addr, count);
+    } else if (name == "help" || name == "h") {
+        out = "step [n], continue, pause\n"
+              "break [addr]..., delete <addr>..., watch <addr> [len], unwatch <addr> [len]\n"
+              "dump, mem <addr> [len], trace [n], disasm [addr] [n]\n"
+              "short forms: s c p b w r (dump) m t l (disasm); addresses are hex\n";
+    } else {
+        throw std::runtime_error("Unknown debugger command: " + name);
+    }
+    return out;
+}
+
+/* -------------------- DISASSEMBLER -------------------- */
+
+std::string disassemble(uint16_t opcode, quirkProfile profile, uint16_t next) {
+    bool superChip = profile == quirkProfile::schip || profile == quirkProfile::xochip;
+    bool xoChip = profile == quirkProfile::xochip;
+
+    unsigned x = (opcode >> 8) & 0xF;
+    unsigned y = (opcode >> 4) & 0xF;
+    unsigned n = opcode & 0xF;
+    unsigned nn = opcode & 0xFF;
+    unsigned nnn = opcode & 0x0FFF;
+
+    char buf[32];
+    auto format = [&](const char* pattern, unsigned a = 0, unsigned b = 0, unsigned c = 0) {
+        std::snprintf(buf, sizeof(buf), pattern, a, b, c);
+        return std::string(buf);
+    };
+
+    switch (opcode >> 12) {
+        case 0x0:
+            if (opcode == 0x00E0) return "CLS";
+            if (opcode == 0x00EE) return "RET";
+            if (superChip) {
+                if ((opcode & 0xFFF0) == 0x00C0) return format("SCD %u", n);
+                if (opcode == 0x00FB) return "SCR";
+                if (opcode == 0x00FC) return "SCL";
+                if (opcode == 0x00FE) return "LOW";
+                if (opcode == 0x00FF) return "HIGH";
+            }
+            break;
+        case 0x1: return format("JP 0x%03X", nnn);
+        case 0x2: return format("CALL 0x%03X", nnn);
+        case 0x3: return format("SE V%X, 0x%02X", x, nn);
+        case 0x4: return format("SNE V%X, 0x%02X", x, nn);
+        case 0x5:
+            if (n == 0) return format("SE V%X, V%X", x, y);
+            if (xoChip && n == 2) return format("SAVE V%X - V%X", x, y);
+            if (xoChip && n == 3) return format("LOAD V%X - V%X", x, y);
+            break;
+        case 0x6: return format("LD V%X, 0x%02X", x, nn);
+        case 0x7: return format("ADD V%X, 0x%02X", x, nn);
+        case 0x8:
+            switch (n) {
+                case 0x0: return format("LD V%X, V%X", x, y);
+                case 0x1: return format("OR V%X, V%X", x, y);
+                case 0x2: return format("AND V%X, V%X", x, y);
+                case 0x3: return format("XOR V%X, V%X", x, y);
+                case 0x4: return format("ADD V%X, V%X", x, y);
+                case 0x5: return format("SUB V%X, V%X", x, y);
+                case 0x6: return format("SHR V%X, V%X", x, y);
+                case 0x7: return format("SUBN V%X, V%X", x, y);
+                case 0xE: return format("SHL V%X, V%X", x, y);
+            }
+            break;
+        case 0x9:
+            if (n == 0) return format("SNE V%X, V%X", x, y);
+            break;
+        case 0xA: return format("LD I, 0x%03X", nnn);
+        case 0xB:
+            // SUPER-CHIP jumps to XNN + VX
+            if (profile == quirkProfile::schip) return format("JP V%X, 0x%03X", x, nnn);
+            return format("JP V0, 0x%03X", nnn);
+        case 0xC: return format("RND V%X, 0x%02X", x, nn);
+        case 0xD: return format("DRW V%X, V%X, %u", x, y, n);
+        case 0xE:
+            if (nn == 0x9E) return format("SKP V%X", x);
+            if (nn == 0xA1) return format("SKNP V%X", x);
+            break;
+        case 0xF:
+            if (xoChip) {
+                if (opcode == 0xF000) return format("LD I, 0x%04X", next);
+                if (nn == 0x01) return format("PLANE %u", x);
+                if (opcode == 0xF002) return "AUDIO";
+                if (nn == 0x3A) return format("PITCH V%X", x);
+            }
+            switch (nn) {
+                case 0x07: return format("LD V%X, DT", x);
+                case 0x0A: return format("LD V%X, K", x);
+                case 0x15: return format("LD DT, V%X", x);
+                case 0x18: return format("LD ST, V%X", x);
+                case 0x1E: return format("ADD I, V%X", x);
+                case 0x29: return format("LD F, V%X", x);
+                case 0x33: return format("LD B, V%X", x);
+                case 0x55: return format("LD [I], V%X", x);
+                case 0x65: return format("LD V%X, [I]", x);
+            }
+            break;
+    }
+    return format("DW 0x%04X", opcode);
+}
@@ -0,0 +1,132 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_DEBUGGER_HPP
+#define CHIP8_EMULATOR_DEBUGGER_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One executed instruction, as it was before it ran
+struct traceEntry {
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t I;
+    uint8_t V[16];
+};
+
+// Why the debugger stopped the core
+enum class debugStop : uint8_t {
+    none,
+    pause,          // asked to (pause(), or a "pause" command)
+    breakpoint,     // PC reached a breakpoint; the instruction hasn't run
+    watchpoint,     // an instruction wrote to watched memory; it has run
+    step            // step(n) ran its n instructions
+};
+
+/*
+    Breakpoints, memory watchpoints and an instruction trace for one chip8
+    (chip8::attachDebugger()).
+
+    The debugger is a policy of the core's per-instruction loops: before()
+    and after() run around every instruction, and returning false stops
+    the run there. Instances without a debugger run the same loops with
+    an empty policy, so they pay nothing. While one is attached, block and
+    native dispatch fall back to the decode cache and idle loops run pass
+    by pass, so every instruction is seen.
+
+    Breakpoints are one bit per code address. Watchpoints are one bit per
+    byte of the 64 KiB address space, checked against what FX33, FX55 and
+    XO-CHIP's 5XY2 are about to write. The trace keeps the last N
+    instructions in a ring.
+
+    While paused, runFor() returns 0 without running anything. command()
+    takes the text commands the front ends read from the console.
+    Not thread-safe; use it on the thread that runs the emulator.
+*/
+class debugger {
+
+private:
+    uint64_t breakpoints[CODE_SIZE / 64] = {};
+    uint64_t watched[MEMORY_SIZE / 64] = {};
+    size_t breakpointCount = 0;
+    size_t watchCount = 0;
+
+    // Ring of the last traceLength instructions, traceNext is the oldest
+    std::vector<traceEntry> trace;
+    size_t traceNext = 0;
+    size_t traceUsed = 0;
+
+    bool paused = false;
+    bool resuming = false;      // don't stop on the breakpoint at PC again
+    uint64_t stepsLeft = 0;     // 0 = run freely
+
+    // The write before() saw coming
+    bool watchHit = false;
+    uint16_t watchAddr = 0;
+
+    debugStop stop = debugStop::none;
+    uint16_t stopPc = 0;        // instruction the stop is about
+    uint16_t stopAddr = 0;      // watched address written
+    bool stopReported = true;
+
+    void halt(debugStop reason, uint16_t pc);
+    uint16_t storeTarget(const chip8& c, uint16_t opcode, int& length) const;
+
+public:
+    explicit debugger(size_t traceLength = 256);
+
+    // Policy hooks, called by chip8 around every instruction
+    bool before(chip8& c);
+    bool after(chip8& c);
+
+    void setBreakpoint(uint16_t addr, bool on = true);
+    bool hasBreakpoint(uint16_t addr) const { return breakpoints[(addr & 0x0FFF) / 64] >> (addr % 64) & 1; }
+    std::vector<uint16_t> getBreakpoints() const;
+
+    // Watch `length` bytes from `addr` (wrapping at 64 KiB)
+    void setWatchpoint(uint16_t addr, uint16_t length = 1, bool on = true);
+    bool isWatched(uint16_t addr) const { return watched[addr / 64] >> (addr % 64) & 1; }
+
+    // Stop before the next instruction
+    void pause();
+
+    // Run on. step() stops again after `count` instructions.
+    void resume();
+    void step(uint64_t count = 1);
+
+    bool isPaused() const { return paused; }
+    debugStop getStop() const { return stop; }
+
+    // True once for every new stop, for front ends that print it
+    bool takeStop();
+
+    // What stopped the core, e.g. "breakpoint at 2A4: D015  DRW V0, V1, 5"
+    std::string describeStop(const chip8& c) const;
+
+    // The trace, oldest first
+    size_t traceSize() const { return traceUsed; }
+    const traceEntry& traceAt(size_t i) const;
+    void clearTrace() { traceNext = traceUsed = 0; }
+
+    // Run one console command and return its output. Throws
+    // std::runtime_error on an unknown command or bad arguments.
+    //     step [n] | continue | pause
+    //     break [addr] | delete <addr> | watch <addr> [len] | unwatch <addr> [len]
+    //     dump | mem <addr> [len] | trace [n] | disasm [addr] [n] | help
+    // Addresses are hex. Most commands have one-letter forms (help).
+    std::string command(chip8& c, const std::string& line);
+
+    // Listing of `count` instructions from `addr`, one per line
+    static std::string listing(const chip8& c, uint16_t addr, size_t count);
+};
+
+// Mnemonic for an opcode under a quirk profile, "DW 1234" for anything
+// the profile doesn't run. `next` is the word after it (F000 NNNN).
+std::string disassemble(uint16_t opcode, quirkProfile profile, uint16_t next = 0);
+
+#endif // CHIP8_EMULATOR_DEBUGGER_HPP
@@ -0,0 +1,203 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "environment.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// Every bit twice over: bit i of v lands in bits 2i and 2i + 1
+static uint64_t doubleBits(uint32_t v) {
+    uint64_t x = v;
+    x = (x | x << 16) & 0x0000FFFF0000FFFFull;
+    x = (x | x << 8) & 0x00FF00FF00FF00FFull;
+    x = (x | x << 4) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | x << 2) & 0x3333333333333333ull;
+    x = (x | x << 1) & 0x5555555555555555ull;
+    return x | x << 1;
+}
+
+// A display word as 8 bytes, leftmost pixel in the top bit of the first
+static uint8_t* putWord(uint8_t* out, uint64_t word) {
+    for (int b = 7; b >= 0; --b)
+        *out++ = static_cast<uint8_t>(word >> (8 * b));
+    return out;
+}
+
+environmentBatch::environmentBatch(const chip8& prototype, size_t count, const environmentConfig& config,
+                                   threadPool& pool)
+        : envs(new chip8[count ? count : 1]), count(count), config(config), pool(pool) {
+    if (count == 0)
+        throw std::runtime_error("An environment batch needs at least one environment");
+    if (config.frameSkip == 0)
+        throw std::runtime_error("frameSkip must be at least 1");
+    if (config.scoreBytes > 4)
+        throw std::runtime_error("A score is at most 4 bytes");
+
+    start.copyFrom(prototype);
+
+    quirkProfile quirks = prototype.getQuirks();
+    bool hiresCapable = quirks == quirkProfile::schip || quirks == quirkProfile::xochip;
+    width = hiresCapable ? 128 : 64;
+    height = hiresCapable ? 64 : 32;
+    planes = config.observation == observationFormat::packed && quirks == quirkProfile::xochip ? 2 : 1;
+    obsBytes = config.observation == observationFormat::packed
+            ? static_cast<size_t>(planes) * width * height / 8
+            : static_cast<size_t>(width) * height;
+
+    episode.assign(count, 0);
+    frames.assign(count, 0);
+    lastScore.assign(count, 0);
+    ended.assign(count, 0);
+
+    resetOne = [this](size_t i) {
+        episode[i] = 0;
+        startEpisode(i);
+        observe(envs[i], stepObservations + i * obsBytes);
+    };
+    stepOne = [this](size_t i) { runStep(i); };
+}
+
+/* -------------------- EPISODES -------------------- */
+
+void environmentBatch::startEpisode(size_t i) {
+    chip8& c = envs[i];
+    c.copyFrom(start);
+    c.seed(baseSeed + episode[i] * count + i);
+    frames[i] = 0;
+    lastScore[i] = score(c);
+    ended[i] = 0;
+}
+
+uint64_t environmentBatch::score(const chip8& c) const {
+    const uint8_t* memory = c.getMemory();
+    uint64_t value = 0;
+    for (uint8_t b = 0; b < config.scoreBytes; ++b) {
+        uint8_t byte = memory[static_cast<uint16_t>(config.scoreAddr + b)];
+        value = config.scoreDigits ? value * 10 + byte : value << 8 | byte;
+    }
+    return value;
+}
+
+bool environmentBatch::isDone(const chip8& c, uint64_t episodeFrames) const {
+    if (c.hasFault())
+        return true;
+    if (config.doneMask && (c.getMemory()[config.doneAddr] & config.doneMask) == config.doneValue)
+        return true;
+    return config.maxFrames && episodeFrames >= config.maxFrames;
+}
+
+/* -------------------- OBSERVATIONS -------------------- */
+
+void environmentBatch::observe(const chip8& c, uint8_t* out) const {
+    bool doubled = width == 128 && !c.isHires();
+
+    if (config.observation == observationFormat::packed) {
+        for (int p = 0; p < planes; ++p) {
+            const uint64_t* rows = c.getPlaneRows(p);
+
+            if (width == 64) {
+                for (int y = 0; y < 32; ++y)
+                    out = putWord(out, rows[2 * y]);
+            } else if (!doubled) {
+                for (int y = 0; y < 64; ++y) {
+                    out = putWord(out, rows[2 * y]);
+                    out = putWord(out, rows[2 * y + 1]);
+                }
+            } else {
+                for (int y = 0; y < 32; ++y) {
+                    uint64_t left = doubleBits(static_cast<uint32_t>(rows[2 * y] >> 32));
+                    uint64_t right = doubleBits(static_cast<uint32_t>(rows[2 * y]));
+                    out = putWord(putWord(out, left), right);
+                    out = putWord(putWord(out, left), right);
+                }
+            }
+        }
+        return;
+    }
+
+    // Colours, one display row at a time
+    const uint64_t* plane0 = c.getPlaneRows(0);
+    const uint64_t* plane1 = c.getPlaneRows(1);
+    int scale = doubled ? 2 : 1;
+    int pixels = width / scale;
+
+    for (int y = 0; y < height / scale; ++y) {
+        uint8_t* row = out + static_cast<size_t>(y) * scale * width;
+        for (int x = 0; x < pixels; ++x) {
+            int shift = 63 - (x & 63);
+            uint8_t colour = static_cast<uint8_t>((plane0[2 * y + (x >> 6)] >> shift & 1)
+                                                | (plane1[2 * y + (x >> 6)] >> shift & 1) << 1);
+            for (int s = 0; s < scale; ++s)
+                row[x * scale + s] = colour;
+        }
+        if (doubled)
+            std::copy(row, row + width, row + width);
+    }
+}
+
+/* -------------------- STEPPING -------------------- */
+
+void environmentBatch::runStep(size_t i) {
+    chip8& c = envs[i];
+    uint8_t* observation = stepObservations + i * obsBytes;
+
+    if (ended[i]) {
+        // Without autoReset an ended episode stays ended until reset()
+        stepRewards[i] = 0.0f;
+        stepDones[i] = 1;
+        observe(c, observation);
+        return;
+    }
+
+    uint16_t action = stepActions[i];
+    c.setKeys(config.actionKeys.empty() ? action : config.actionKeys[action]);
+
+    bool done = false;
+    for (uint32_t f = 0; f < config.frameSkip && !done; ++f) {
+        c.runFrame();
+        done = isDone(c, ++frames[i]);
+    }
+
+    uint64_t now = score(c);
+    stepRewards[i] = static_cast<float>(static_cast<int64_t>(now - lastScore[i]));
+    lastScore[i] = now;
+    stepDones[i] = done ? 1 : 0;
+
+    if (done) {
+        ended[i] = 1;
+        if (config.autoReset) {
+            ++episode[i];
+            startEpisode(i);
+        }
+    }
+    observe(c, observation);
+}
+
+void environmentBatch::reset(uint64_t seed, uint8_t* observations) {
+    baseSeed = seed;
+    stepObservations = observations;
+    pool.parallelFor(count, resetOne);
+    stepObservations = nullptr;
+}
+
+void environmentBatch::step(const uint16_t* actions, uint8_t* observations, float* rewards, uint8_t* dones) {
+    if (!config.actionKeys.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            if (actions[i] >= config.actionKeys.size())
+                throw std::runtime_error("Action " + std::to_string(actions[i]) + " has no keys");
+        }
+    }
+
+    stepActions = actions;
+    stepObservations = observations;
+    stepRewards = rewards;
+    stepDones = dones;
+    pool.parallelFor(count, stepOne);
+
+    stepActions = nullptr;
+    stepObservations = nullptr;
+    stepRewards = nullptr;
+    stepDones = nullptr;
+}
@@ -0,0 +1,135 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_ENVIRONMENT_HPP
+#define CHIP8_EMULATOR_ENVIRONMENT_HPP
+
+#include "chip8.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// How an environment's observation is laid out in the caller's buffer
+enum class observationFormat : uint8_t {
+    packed,     // one bit per pixel, 8 to a byte, leftmost in the top bit; XO-CHIP's planes one after the other
+    bytes       // one byte per pixel: its colour, 0–3
+};
+
+struct environmentConfig {
+    uint32_t frameSkip = 4;             // 60 Hz frames per step, the action held for all of them
+    observationFormat observation = observationFormat::packed;
+
+    // Discrete actions: action a holds the keys in actionKeys[a]. Empty:
+    // an action is the key mask itself (bit k = key k).
+    std::vector<uint16_t> actionKeys;
+
+    // Reward: how much the score grew during the step. The score is
+    // scoreBytes (0 = no reward, up to 4) bytes at scoreAddr, big-endian,
+    // or one decimal digit per byte as FX33 stores them.
+    uint16_t scoreAddr = 0;
+    uint8_t scoreBytes = 0;
+    bool scoreDigits = false;
+
+    // Done: after any frame, memory[doneAddr] & doneMask == doneValue
+    // (doneMask 0 = never), a fault, or maxFrames frames in the episode
+    // (0 = no limit)
+    uint16_t doneAddr = 0;
+    uint8_t doneMask = 0;
+    uint8_t doneValue = 0;
+    uint64_t maxFrames = 0;
+
+    // Start a new episode as soon as one is done; the step then returns
+    // the new episode's first observation. Without it an ended episode
+    // stays ended (done 1, reward 0) until reset().
+    bool autoReset = true;
+};
+
+/*
+    A vector of N emulators of one ROM, stepped together for reinforcement
+    learning.
+
+    Every episode starts as a copy of the prototype given at construction
+    (ROM loaded, quirks and speed set, any setup frames run), with its own
+    seed: episode e of environment i is seeded with seed + e × N + i. A
+    step sets each environment's keys from its action, runs frameSkip
+    frames (stopping early when the episode ends), and writes its reward,
+    done flag and observation into the caller's arrays. Observations are
+    observationSize() bytes per environment, back to back in environment
+    order: 64 × 32 pixels, or 128 × 64 for the SUPER-CHIP and XO-CHIP
+    profiles, with lo-res screens doubled up.
+
+    The environments are split across the thread pool's workers; nothing is
+    allocated per step. Each instance is about 130 KiB.
+    Not thread-safe: step one batch from one thread at a time.
+*/
+class environmentBatch {
+
+private:
+    std::unique_ptr<chip8[]> envs;
+    size_t count;
+    chip8 start;
+    environmentConfig config;
+    threadPool& pool;
+
+    int width;
+    int height;
+    int planes;
+    size_t obsBytes;
+
+    uint64_t baseSeed = 0;
+    std::vector<uint64_t> episode;      // episodes finished, per environment
+    std::vector<uint64_t> frames;       // frames into the current episode
+    std::vector<uint64_t> lastScore;
+    std::vector<uint8_t> ended;         // episode over (kept until reset() without autoReset)
+
+    // The call in progress, read by the workers
+    const uint16_t* stepActions = nullptr;
+    uint8_t* stepObservations = nullptr;
+    float* stepRewards = nullptr;
+    uint8_t* stepDones = nullptr;
+
+    // Built once, so parallelFor() gets no new closure per call
+    std::function<void(size_t)> resetOne;
+    std::function<void(size_t)> stepOne;
+
+    void startEpisode(size_t i);
+    void runStep(size_t i);
+    uint64_t score(const chip8& c) const;
+    bool isDone(const chip8& c, uint64_t episodeFrames) const;
+    void observe(const chip8& c, uint8_t* out) const;
+
+public:
+    environmentBatch(const chip8& prototype, size_t count, const environmentConfig& config, threadPool& pool);
+
+    environmentBatch(const environmentBatch&) = delete;
+    environmentBatch& operator=(const environmentBatch&) = delete;
+
+    size_t size() const { return count; }
+
+    // Observation shape: bytes per environment, and the pixels and
+    // planes in it (planes is 2 only for packed XO-CHIP observations)
+    size_t observationSize() const { return obsBytes; }
+    int getObservationWidth() const { return width; }
+    int getObservationHeight() const { return height; }
+    int getObservationPlanes() const { return planes; }
+
+    // Start every environment on a new episode. `observations` gets
+    // size() × observationSize() bytes.
+    void reset(uint64_t seed, uint8_t* observations);
+
+    // One step of every environment: actions[i] for environment i, and
+    // size() rewards, done flags (1 = the episode ended this step) and
+    // observations out. Throws std::runtime_error if an action has no
+    // entry in actionKeys.
+    void step(const uint16_t* actions, uint8_t* observations, float* rewards, uint8_t* dones);
+
+    // An environment's emulator, and how many episodes it has finished
+    const chip8& get(size_t i) const { return envs[i]; }
+    uint64_t getEpisode(size_t i) const { return episode[i]; }
+};
+
+#endif // CHIP8_EMULATOR_ENVIRONMENT_HPP
@@ -0,0 +1,163 @@
+//
+// Created by patel on 2026-10-16.
+//
+// Coverage-guided fuzz target for the core (libFuzzer interface), built
+// with -DCHIP8_FUZZ=ON. No SDL, and nothing is printed while fuzzing.
+//
+// Input layout:
+//     byte 0      bits 0-1 quirk profile, bits 2-3 dispatch mode
+//     bytes 1-2   ROM length L (little-endian), clamped to what's left
+//     L bytes     ROM image, loaded at 0x200
+//     the rest    keypad script: one 16-bit key mask per KEY_SLICE cycles
+// With CHIP8_FUZZ_ROM=<file> set, the ROM comes from that file instead and
+// everything after byte 0 is keypad script, to fuzz one game's input.
+//
+// Coverage: besides the fuzzer's own instrumentation of the core, every
+// emulated instruction reports its PC, and the harness counts
+// (previous PC, PC) edges into libFuzzer's extra counters. A skip
+// (3XNN/4XNN/5XY0/9XY0/EX9E/EXA1) taken and not taken lands on different
+// edges, so both outcomes count as new coverage.
+//
+// Everything that used to be undefined behaviour in the core (stack over-
+// and underflow, keys above 0xF, classic memory accesses past 0xFFF) is a
+// fault now, which ends the run. Set CHIP8_FUZZ_TRAP=1 to abort on faults
+// other than unknown opcodes, so the fuzzer saves the input as a crash.
+//
+// Without libFuzzer (e.g. GCC) the same file builds a small driver that
+// replays inputs given as files and reports execs per second.
+//
+
+#include "chip8.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Instructions run per input, and how long each key mask is held
+static uint64_t cycleBudget = 2048;
+static const uint64_t KEY_SLICE = 64;
+
+static std::vector<uint8_t> fixedRom;
+static bool trapFaults = false;
+
+/* -------------------- COVERAGE -------------------- */
+
+static const size_t EDGE_COUNTERS = 1 << 16;
+
+#if defined(__linux__) && defined(CHIP8_LIBFUZZER)
+// libFuzzer picks up counters placed in this section as extra coverage
+__attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t edgeCounters[EDGE_COUNTERS];
+
+static uint16_t previousPc = 0;
+
+void chip8CoverageStep(uint16_t pc) {
+    // AFL-style edge hash: the shift keeps A->B and B->A apart
+    uint16_t edge = static_cast<uint16_t>((previousPc << 4) ^ pc);
+    ++edgeCounters[edge];
+    previousPc = pc >> 1;
+}
+
+/* -------------------- TARGET -------------------- */
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+    if (const char* budget = std::getenv("CHIP8_FUZZ_CYCLES"))
+        cycleBudget = std::strtoull(budget, nullptr, 0);
+    if (const char* trap = std::getenv("CHIP8_FUZZ_TRAP"))
+        trapFaults = std::atoi(trap) != 0;
+
+    if (const char* path = std::getenv("CHIP8_FUZZ_ROM")) {
+        std::ifstream in(path, std::ios::binary);
+        fixedRom.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // One instance for the whole run; reset() only clears what the last
+    // input touched
+    static chip8 emulator;
+
+    if (size < 1)
+        return 0;
+
+    static const quirkProfile PROFILES[4] = {
+            quirkProfile::legacy, quirkProfile::chip8, quirkProfile::schip, quirkProfile::xochip
+    };
+    static const dispatchMode MODES[3] = {
+            dispatchMode::interpreter, dispatchMode::cached, dispatchMode::block
+    };
+
+    // reset() keeps the profile; only switching it flushes decoded code
+    emulator.reset();
+    if (emulator.getQuirks() != PROFILES[data[0] & 3])
+        emulator.setQuirks(PROFILES[data[0] & 3]);
+    emulator.setDispatchMode(MODES[((data[0] >> 2) & 3) % 3]);
+
+    size_t at = 1;
+    if (!fixedRom.empty()) {
+        emulator.loadROM(fixedRom.data(), fixedRom.size());
+    } else {
+        if (size < 3)
+            return 0;
+        size_t length = data[1] | (data[2] << 8);
+        length = std::min({ length, size - 3, MEMORY_SIZE - 0x200 });
+        emulator.loadROM(data + 3, length);
+        at = 3 + length;
+    }
+
+    previousPc = 0;
+    uint64_t done = 0;
+    while (done < cycleBudget && !emulator.hasFault()) {
+        if (at + 1 < size) {
+            emulator.setKeys(static_cast<uint16_t>(data[at] | (data[at + 1] << 8)));
+            at += 2;
+        }
+        done += emulator.runFor(std::min(KEY_SLICE, cycleBudget - done));
+    }
+
+    if (trapFaults && emulator.hasFault() && emulator.getFault() != faultKind::unknownOpcode)
+        std::abort();
+    return 0;
+}
+
+/* -------------------- STANDALONE DRIVER -------------------- */
+
+#ifndef CHIP8_LIBFUZZER
+#include <chrono>
+#include <cstdio>
+
+// chip8_fuzz [-runs=N] input...: run each input N times (default 1)
+int main(int argc, char** argv) {
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    long runs = 1;
+    std::vector<std::vector<uint8_t>> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = std::atol(argv[i] + 6);
+            continue;
+        }
+        std::ifstream in(argv[i], std::ios::binary);
+        inputs.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t execs = 0;
+    for (long r = 0; r < runs; ++r) {
+        for (const auto& input : inputs) {
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+            ++execs;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::fprintf(stderr, "%llu execs in %.2f s (%.0f execs/s)\n",
+                 static_cast<unsigned long long>(execs), seconds, seconds > 0 ? execs / seconds : 0.0);
+    return 0;
+}
+#endif
@@ -0,0 +1,547 @@
+//
+// Created by patel on 2026-10-16.
+//
+// Headless batch runner: runs many ROMs in parallel, no SDL.
+//
+// Job list format (one job per line, '#' starts a comment):
+//     <rom path> <cycle budget> [input script | input movie]
+//
+// Input script format (one event per line, sorted by cycle):
+//     <cycle> <key mask in hex>
+// From that cycle on, key k is held while bit k of the mask is set.
+//
+// An input movie (recorded by the SDL front end with --record) brings its
+// own seed and CPU speed. A cycle budget of 0 replays the whole movie, and
+// the status reads "desync" if the final display doesn't match the one
+// recorded.
+//
+// Quirks come from --quirks if given, else from the --quirk-db entry for
+// the ROM's hash, else the legacy profile. Movies carry their own.
+//
+// --library <dir | pack> (repeatable) memory-maps a ROM library up front.
+// Job ROMs found in it, by name or as hash:<hex>, are copied straight from
+// the mapping and keep the hash computed when it was indexed. Anything
+// else is read from disk. --write-pack <file> saves the libraries given
+// as one pack file.
+//
+// Built with -DCHIP8_PROFILE=ON, --profile <prefix> writes each job's
+// profiler report to <prefix><job>.txt and its call stacks, in folded
+// flame-graph format, to <prefix><job>.folded.
+//
+// --capture <prefix> records each job's display, frame by frame, to
+// <prefix><job>.c8fc (see capture.hpp); chip8_capture turns that into a
+// Y4M video or an animated GIF.
+//
+// --debug <script> runs every job under a debugger (see debugger.hpp). A
+// job starts paused and runs script commands, one per line, until one
+// of them (step, continue) lets it run; each stop then runs the next
+// commands. A job whose script runs out while it is paused ends there
+// with status "paused". The transcripts go to stderr, job by job.
+//
+
+#include "capture.hpp"
+#include "chip8.hpp"
+#include "debugger.hpp"
+#include "movie.hpp"
+#include "rom_library.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct job {
+    std::string rom;
+    uint64_t cycles = 0;
+    std::string inputScript;
+};
+
+// Settings shared by every job
+struct runSettings {
+    dispatchMode mode = dispatchMode::block;
+    uint32_t cpuHz = 600;
+    uint64_t seed = 0;
+    bool idleSkipping = true;
+    bool quirksGiven = false;
+    quirkProfile quirks = quirkProfile::legacy;
+    quirkDatabase quirkDb;
+    romLibrary library;
+    std::string profilePrefix;
+    std::string capturePrefix;
+    std::vector<std::string> debugScript;
+};
+
+struct inputEvent {
+    uint64_t cycle;
+    uint16_t keys;
+};
+
+struct runResult {
+    std::string status = "ok";
+    uint64_t cyclesRun = 0;
+    double seconds = 0.0;
+
+    uint8_t V[16] = {};
+    uint16_t I = 0;
+    uint16_t pc = 0;
+    uint16_t sp = 0;
+    uint8_t delayTimer = 0;
+    uint8_t soundTimer = 0;
+    uint64_t fbHash = 0;
+    uint64_t idleCycles = 0;
+
+    std::string debugLog;
+};
+
+static std::vector<job> readJobList(std::istream& in) {
+    std::vector<job> jobs;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+
+        std::istringstream fields(line);
+        job j;
+        if (!(fields >> j.rom))
+            continue; // blank line
+
+        if (!(fields >> j.cycles))
+            throw std::runtime_error("Job is missing a cycle budget: " + line);
+
+        fields >> j.inputScript;
+        jobs.push_back(j);
+    }
+    return jobs;
+}
+
+static std::vector<inputEvent> readInputScript(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open input script: " + filename);
+    }
+
+    std::vector<inputEvent> events;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+
+        std::istringstream fields(line);
+        uint64_t cycle;
+        unsigned mask;
+        if (!(fields >> cycle))
+            continue;
+        if (!(fields >> std::hex >> mask))
+            throw std::runtime_error("Bad input event in " + filename + ": " + line);
+
+        if (!events.empty() && cycle < events.back().cycle)
+            throw std::runtime_error("Input script is not sorted by cycle: " + filename);
+
+        events.push_back({ cycle, static_cast<uint16_t>(mask) });
+    }
+    return events;
+}
+
+static std::vector<std::string> readDebugScript(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open debugger script: " + filename);
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        if (line.find_first_not_of(" \t\r") != std::string::npos)
+            lines.push_back(line);
+    }
+    return lines;
+}
+
+static void writeProfile(const chip8& emulator, const std::string& prefix) {
+#ifdef CHIP8_PROFILE
+    std::ofstream report(prefix + ".txt");
+    emulator.getProfiler().writeReport(report);
+    std::ofstream folded(prefix + ".folded");
+    emulator.getProfiler().writeFolded(folded);
+#else
+    (void)emulator;
+    (void)prefix;
+#endif
+}
+
+static runResult runJob(const job& j, const runSettings& settings,
+                        const std::string& profilePrefix, const std::string& capturePath) {
+    runResult result;
+
+    try {
+        chip8 emulator;
+        emulator.setDispatchMode(settings.mode);
+        emulator.setCpuHz(settings.cpuHz);
+        emulator.seed(settings.seed);
+        emulator.setIdleSkipping(settings.idleSkipping);
+
+        const romEntry* rom = nullptr;
+        if (j.rom.compare(0, 5, "hash:") == 0) {
+            rom = settings.library.find(std::stoull(j.rom.substr(5), nullptr, 16));
+            if (!rom)
+                throw std::runtime_error("No ROM in the library with " + j.rom);
+        } else {
+            rom = settings.library.find(j.rom);
+        }
+
+        if (rom) {
+            emulator.loadROM(rom->data, rom->size, rom->hash);
+        } else {
+            emulator.loadROM(j.rom);
+        }
+
+        quirkProfile quirks = settings.quirks;
+        if (!settings.quirksGiven)
+            settings.quirkDb.lookup(emulator.getROMHash(), quirks);
+        emulator.setQuirks(quirks);
+
+        bool replay = !j.inputScript.empty() && inputMovie::isMovie(j.inputScript);
+        inputMovie movie;
+        std::vector<inputEvent> events;
+        uint64_t budget = j.cycles;
+
+        if (replay) {
+            movie = inputMovie::load(j.inputScript);
+            if (budget == 0)
+                budget = movie.length;
+        } else if (!j.inputScript.empty()) {
+            events = readInputScript(j.inputScript);
+        }
+
+        moviePlayer player(movie);
+        if (replay)
+            player.prepare(emulator);
+
+        /* -------------------- DEBUGGER -------------------- */
+        std::unique_ptr<debugger> dbg;
+        size_t nextCommand = 0;
+
+        // Log the stop, then run script commands while the job is paused.
+        // Returns false if it stays paused.
+        auto debugCommands = [&] {
+            if (dbg->takeStop())
+                result.debugLog += dbg->describeStop(emulator);
+
+            while (dbg->isPaused() && nextCommand < settings.debugScript.size()) {
+                const std::string& line = settings.debugScript[nextCommand++];
+                result.debugLog += "> " + line + "\n";
+                try {
+                    result.debugLog += dbg->command(emulator, line);
+                } catch (const std::exception& e) {
+                    result.debugLog += std::string(e.what()) + "\n";
+                }
+            }
+            return !dbg->isPaused();
+        };
+
+        bool running = true;
+        if (!settings.debugScript.empty()) {
+            dbg.reset(new debugger());
+            emulator.attachDebugger(dbg.get());
+            dbg->pause();
+            dbg->takeStop();
+            running = debugCommands();
+        }
+
+        /* -------------------- CAPTURE -------------------- */
+        // A batch job has no frame deadline and runs far ahead of the
+        // writer, so it waits for queue space rather than drop frames
+        std::unique_ptr<frameCapture> capture;
+        if (!capturePath.empty()) {
+            capture.reset(new frameCapture(256, true));
+            capture->open(capturePath, emulator);
+        }
+
+        // With a capture, runs stop at every frame so it sees each one
+        auto runTo = [&](uint64_t until, uint64_t cycle) {
+            bool toFrame = capture && emulator.cyclesUntilFrame() <= until - cycle;
+            uint64_t want = toFrame ? emulator.cyclesUntilFrame() : until - cycle;
+            uint64_t ran = replay ? player.runFor(emulator, want) : emulator.runFor(want);
+            if (toFrame && ran == want) {
+                capture->frame(emulator);
+                emulator.resetDrawFlag();
+            }
+            return ran;
+        };
+
+        size_t nextEvent = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        /* -------------------- CPU -------------------- */
+        uint64_t cycle = 0;
+        if (replay) {
+            while (running && cycle < budget && !emulator.hasFault()) {
+                cycle += runTo(budget, cycle);
+                if (dbg && dbg->isPaused())
+                    running = debugCommands();
+            }
+        } else {
+            while (running && cycle < budget && !emulator.hasFault()) {
+                while (nextEvent < events.size() && events[nextEvent].cycle <= cycle) {
+                    emulator.setKeys(events[nextEvent].keys);
+                    ++nextEvent;
+                }
+
+                // Run straight through to the next key change
+                uint64_t until = budget;
+                if (nextEvent < events.size() && events[nextEvent].cycle < until)
+                    until = events[nextEvent].cycle;
+
+                cycle += runTo(until, cycle);
+                if (dbg && dbg->isPaused())
+                    running = debugCommands();
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        if (capture)
+            capture->close();
+
+        if (emulator.hasFault()) {
+            // Unknown opcodes keep the original "fault:<opcode>" form
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), "fault:%04X", emulator.faultOpcode());
+            result.status = buf;
+            if (emulator.getFault() != faultKind::unknownOpcode)
+                result.status += std::string(":") + faultKindName(emulator.getFault());
+        } else if (replay && cycle == movie.length && emulator.displayHash() != movie.finalHash) {
+            result.status = "desync";
+        } else if (!running) {
+            result.status = "paused";
+        }
+
+        /* -------------------- RESULTS -------------------- */
+        result.cyclesRun = cycle;
+        result.seconds = std::chrono::duration<double>(end - start).count();
+
+        const uint8_t* regs = emulator.getRegisters();
+        for (int i = 0; i < 16; ++i)
+            result.V[i] = regs[i];
+        result.I = emulator.getIndex();
+        result.pc = emulator.getPC();
+        result.sp = emulator.getSP();
+        result.delayTimer = emulator.getDelayTimer();
+        result.soundTimer = emulator.getSoundTimer();
+        result.fbHash = emulator.displayHash();
+        result.idleCycles = emulator.getIdleCycles();
+
+        if (!profilePrefix.empty())
+            writeProfile(emulator, profilePrefix);
+    } catch (const std::exception& e) {
+        result.status = std::string("error:") + e.what();
+        // Keep the CSV well formed
+        for (char& c : result.status)
+            if (c == ',' || c == '\n')
+                c = ' ';
+    }
+
+    return result;
+}
+
+static void writeResults(std::ostream& out, const std::vector<job>& jobs,
+                         const std::vector<runResult>& results) {
+    out << "rom,status,cycles,pc,i,sp,dt,st";
+    for (int i = 0; i < 16; ++i) {
+        char name[8];
+        std::snprintf(name, sizeof(name), ",v%x", i);
+        out << name;
+    }
+    out << ",fb_hash,cycles_per_sec,idle_cycles\n";
+
+    for (size_t n = 0; n < jobs.size(); ++n) {
+        const runResult& r = results[n];
+        char buf[128];
+
+        out << jobs[n].rom << ',' << r.status << ',' << r.cyclesRun;
+        std::snprintf(buf, sizeof(buf), ",%03X,%03X,%u,%u,%u",
+                      r.pc, r.I, r.sp, r.delayTimer, r.soundTimer);
+        out << buf;
+
+        for (uint8_t v : r.V) {
+            std::snprintf(buf, sizeof(buf), ",%02X", v);
+            out << buf;
+        }
+
+        double cps = (r.seconds > 0.0) ? r.cyclesRun / r.seconds : 0.0;
+        std::snprintf(buf, sizeof(buf), ",%016llX,%.0f,%llu",
+                      static_cast<unsigned long long>(r.fbHash), cps,
+                      static_cast<unsigned long long>(r.idleCycles));
+        out << buf << '\n';
+    }
+}
+
+static void printUsage() {
+    std::cerr << "Usage: chip8_headless [-j threads] [-o results.csv] [--hz cpu speed] [--seed n] [--no-idle-skip]\n"
+              << "                      [--dispatch interpreter|cached|block|native] [--profile prefix] [--debug script]\n"
+              << "                      [--capture prefix]\n"
+              << "                      [--quirks legacy|chip8|schip|xochip] [--quirk-db file]\n"
+              << "                      [--library dir|pack]... [--write-pack file]\n"
+              << "                      <job list | ->\n"
+              << "  job list lines: <rom | hash:hex> <cycles> [input script | input movie]\n";
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threads = std::thread::hardware_concurrency();
+    std::string outputPath;
+    std::string jobListPath;
+    std::string packPath;
+    runSettings settings;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "-j" && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--hz" && i + 1 < argc) {
+            settings.cpuHz = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            settings.seed = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--no-idle-skip") {
+            settings.idleSkipping = false;
+        } else if (arg == "--quirks" && i + 1 < argc) {
+            if (!parseQuirkProfile(argv[++i], settings.quirks)) {
+                std::cerr << "Unknown quirk profile: " << argv[i] << "\n";
+                return 1;
+            }
+            settings.quirksGiven = true;
+        } else if (arg == "--quirk-db" && i + 1 < argc) {
+            try {
+                settings.quirkDb.load(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--library" && i + 1 < argc) {
+            try {
+                settings.library.add(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--write-pack" && i + 1 < argc) {
+            packPath = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            settings.profilePrefix = argv[++i];
+#ifndef CHIP8_PROFILE
+            std::cerr << "--profile needs a build with -DCHIP8_PROFILE=ON\n";
+            return 1;
+#endif
+        } else if (arg == "--capture" && i + 1 < argc) {
+            settings.capturePrefix = argv[++i];
+        } else if (arg == "--debug" && i + 1 < argc) {
+            try {
+                settings.debugScript = readDebugScript(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg == "--dispatch" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "interpreter") {
+                settings.mode = dispatchMode::interpreter;
+            } else if (name == "cached") {
+                settings.mode = dispatchMode::cached;
+            } else if (name == "block") {
+                settings.mode = dispatchMode::block;
+            } else if (name == "native") {
+                settings.mode = dispatchMode::native;
+            } else {
+                std::cerr << "Unknown dispatch mode: " << name << "\n";
+                return 1;
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else {
+            jobListPath = arg;
+        }
+    }
+
+    if (!packPath.empty()) {
+        try {
+            settings.library.writePack(packPath);
+            std::cerr << "Wrote " << settings.library.size() << " ROMs to " << packPath << "\n";
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        if (jobListPath.empty())
+            return 0;
+    }
+
+    if (jobListPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<job> jobs;
+    try {
+        if (jobListPath == "-") {
+            jobs = readJobList(std::cin);
+        } else {
+            std::ifstream in(jobListPath);
+            if (!in.is_open())
+                throw std::runtime_error("Failed to open job list: " + jobListPath);
+            jobs = readJobList(in);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    // Every job gets its own chip8 and its own result slot, so the
+    // workers share nothing but the job list
+    std::vector<runResult> results(jobs.size());
+    {
+        threadPool pool(threads);
+        for (size_t n = 0; n < jobs.size(); ++n) {
+            pool.submit([&jobs, &results, &settings, n] {
+                std::string prefix;
+                if (!settings.profilePrefix.empty())
+                    prefix = settings.profilePrefix + std::to_string(n);
+                std::string capturePath;
+                if (!settings.capturePrefix.empty())
+                    capturePath = settings.capturePrefix + std::to_string(n) + ".c8fc";
+                results[n] = runJob(jobs[n], settings, prefix, capturePath);
+            });
+        }
+        pool.wait();
+    }
+
+    for (size_t n = 0; n < jobs.size(); ++n) {
+        if (!results[n].debugLog.empty())
+            std::cerr << "# job " << n << ": " << jobs[n].rom << "\n" << results[n].debugLog;
+    }
+
+    if (outputPath.empty()) {
+        writeResults(std::cout, jobs, results);
+    } else {
+        std::ofstream out(outputPath);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open output: " << outputPath << "\n";
+            return 1;
+        }
+        writeResults(out, jobs, results);
+    }
+
+    return 0;
+}
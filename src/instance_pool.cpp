@@ -0,0 +1,57 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "instance_pool.hpp"
+
+instancePool::instancePool(size_t chunkSize) : chunkSize(chunkSize ? chunkSize : 1) {
+}
+
+void instancePool::grow() {
+    chunks.push_back(std::make_unique<chip8[]>(chunkSize));
+    chip8* chunk = chunks.back().get();
+
+    // Hand out the chunk front to back
+    for (size_t i = chunkSize; i-- > 0;)
+        freshList.push_back(chunk + i);
+}
+
+chip8* instancePool::acquire() {
+    // A fresh instance is already in the power-on state
+    if (freeList.empty()) {
+        if (freshList.empty())
+            grow();
+        chip8* instance = freshList.back();
+        freshList.pop_back();
+        return instance;
+    }
+
+    chip8* instance = freeList.back();
+    freeList.pop_back();
+    instance->reset();
+    if (instance->getQuirks() != quirkProfile::legacy)
+        instance->setQuirks(quirkProfile::legacy);
+    return instance;
+}
+
+chip8* instancePool::clone(const chip8& source) {
+    // copyFrom() overwrites everything, so a used instance is as good as
+    // a fresh one, and likelier to be warm in the cache
+    chip8* instance;
+    if (!freeList.empty()) {
+        instance = freeList.back();
+        freeList.pop_back();
+    } else {
+        if (freshList.empty())
+            grow();
+        instance = freshList.back();
+        freshList.pop_back();
+    }
+    instance->copyFrom(source);
+    return instance;
+}
+
+void instancePool::release(chip8* instance) {
+    if (instance)
+        freeList.push_back(instance);
+}
@@ -0,0 +1,49 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_INSTANCE_POOL_HPP
+#define CHIP8_EMULATOR_INSTANCE_POOL_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Arena of chip8 instances for code that forks emulators by the million
+// (fuzzing, tree search over inputs).
+//
+// Instances are allocated a chunk at a time and never move. Released ones
+// go on a free list and come back out of acquire() / clone(), so once the
+// pool has grown to the working set nothing is allocated or constructed.
+// Not thread-safe: give each thread its own pool.
+class instancePool {
+
+private:
+    std::vector<std::unique_ptr<chip8[]>> chunks;
+    std::vector<chip8*> freshList;  // never handed out: still as constructed
+    std::vector<chip8*> freeList;   // came back through release()
+    size_t chunkSize;
+
+    void grow();
+
+public:
+    explicit instancePool(size_t chunkSize = 64);
+
+    // A power-on instance on the legacy profile, ready for loadROM. One
+    // that was used before is reset() first (see there for what that
+    // clears: its debugger is detached and its dispatch mode goes back to
+    // cached), and put back on the legacy profile if it had another.
+    chip8* acquire();
+
+    // An exact copy of `source` (chip8::copyFrom())
+    chip8* clone(const chip8& source);
+
+    // Hand an instance back. It is reset lazily, when reused.
+    void release(chip8* instance);
+
+    size_t capacity() const { return chunks.size() * chunkSize; }
+    size_t available() const { return freshList.size() + freeList.size(); }
+};
+
+#endif // CHIP8_EMULATOR_INSTANCE_POOL_HPP
@@ -0,0 +1,922 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "lockstep.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+// Profiling and fuzzing hooks only sit in the core's own dispatch loops
+#if defined(CHIP8_PROFILE) || defined(CHIP8_COVERAGE)
+static constexpr bool SCALAR_ONLY = true;
+#else
+static constexpr bool SCALAR_ONLY = false;
+#endif
+
+static constexpr size_t LANES = lockstepBatch::LANES;
+
+// Longest slice, so per-lane cycle counts fit in 32 bits
+static constexpr uint64_t MAX_SLICE = 1u << 30;
+
+// runFor() picks its path for at most this many cycles at a time, so
+// long runs still get checked
+static constexpr uint64_t PATH_SLICE = 1u << 14;
+
+// Runs timed on each path per check, and untimed runs between checks
+// (doubling up to the longest while the checks agree)
+static constexpr uint32_t TIMED_RUNS = 8;
+static constexpr uint32_t MIN_RUN_LENGTH = 256;
+static constexpr uint32_t MAX_RUN_LENGTH = 16384;
+
+/* -------------------- COLUMN KERNELS -------------------- */
+
+/*
+    Every kernel works on whole columns: lane l takes the new value where
+    m[l] is 0xFF and keeps its own where it is 0. The loops have a fixed
+    trip count and no branches, so they vectorize for whatever the target
+    has (SSE2 by default on x86-64, AVX2 with -march, NEON on ARM).
+*/
+
+static inline void blend8(uint8_t* dst, const uint8_t* value, const uint8_t* m) {
+    for (size_t l = 0; l < LANES; ++l)
+        dst[l] = static_cast<uint8_t>((dst[l] & ~m[l]) | (value[l] & m[l]));
+}
+
+static inline uint16_t wide(uint8_t m) {
+    return static_cast<uint16_t>(static_cast<int8_t>(m));
+}
+
+static inline void blend16(uint16_t* dst, const uint16_t* value, const uint8_t* m) {
+    for (size_t l = 0; l < LANES; ++l)
+        dst[l] = static_cast<uint16_t>((dst[l] & ~wide(m[l])) | (value[l] & wide(m[l])));
+}
+
+static inline void fill16(uint16_t* dst, uint16_t value, const uint8_t* m) {
+    for (size_t l = 0; l < LANES; ++l)
+        dst[l] = static_cast<uint16_t>((dst[l] & ~wide(m[l])) | (value & wide(m[l])));
+}
+
+// pc += skip where taken[l] is 0xFF, else 2
+static inline void skipIf(uint16_t* pc, const uint8_t* taken, uint8_t skip, const uint8_t* m) {
+    for (size_t l = 0; l < LANES; ++l)
+        pc[l] = static_cast<uint16_t>(pc[l] + (m[l] & (2 + (taken[l] & (skip - 2)))));
+}
+
+static inline uint8_t flag(bool b) {
+    return b ? 0xFF : 0x00;
+}
+
+// A lane's PC for a signed min (SSE2 has no unsigned one), or INT16_MAX
+// for lanes outside the mask
+static inline int16_t pcKey(uint16_t pc, uint8_t m) {
+    return static_cast<int16_t>(((pc ^ 0x8000) & wide(m)) | (0x7FFF & ~wide(m)));
+}
+
+// Same as the core: data addresses are 12 bits, or 16 for XO-CHIP
+template <typename Q>
+static inline uint16_t dataAddr(unsigned addr) {
+    return Q::xoChip ? static_cast<uint16_t>(addr) : addr & 0x0FFF;
+}
+
+// How an instruction moves PC, as far as the batch is concerned
+enum class laneFlow {
+    next,       // on to the next instruction in every lane
+    jump,       // to the same address in every lane (1NNN)
+    call,       // 2NNN: a jump that also pushes each lane's return address
+    split,      // per lane: skips (EX9E / EXA1 too), BNNN and 00EE
+    fallback    // run through the core's own handlers, lane by lane
+};
+
+static laneFlow flowOf(uint16_t opcode) {
+    uint8_t n = opcode & 0xF;
+    uint8_t nn = opcode & 0xFF;
+
+    switch (opcode >> 12) {
+        case 0x0:
+            return opcode == 0x00EE ? laneFlow::split : laneFlow::fallback;
+        case 0x1:
+            return laneFlow::jump;
+        case 0x2:
+            return laneFlow::call;
+        case 0x3: case 0x4: case 0xB:
+            return laneFlow::split;
+        case 0x5: case 0x9:
+            return n == 0 ? laneFlow::split : laneFlow::fallback;
+        case 0x6: case 0x7: case 0xA: case 0xC:
+            return laneFlow::next;
+        case 0x8:
+            return (n <= 0x7 || n == 0xE) ? laneFlow::next : laneFlow::fallback;
+        case 0xE:
+            return (nn == 0x9E || nn == 0xA1) ? laneFlow::split : laneFlow::fallback;
+        case 0xF:
+            switch (nn) {
+                case 0x07: case 0x15: case 0x18: case 0x1E: case 0x29:
+                case 0x33: case 0x55: case 0x65:
+                    return laneFlow::next;
+                default:
+                    return laneFlow::fallback;
+            }
+        default:
+            return laneFlow::fallback;
+    }
+}
+
+/* -------------------- LANES -------------------- */
+
+lockstepBatch::lockstepBatch(size_t n)
+    : count(n), stale(true), synced(false), dirty(false), phase(pathPhase::timeSeparate),
+      phaseLeft(TIMED_RUNS + 1), runLength(MIN_RUN_LENGTH), separateFaster(false), adaptive(true),
+      separateNs(0.0), batchNs(0.0), separateRan(0), batchRan(0) {
+    if (n == 0 || n > LANES) {
+        throw std::runtime_error("A lockstep batch holds 1 to 32 lanes");
+    }
+    lanes = std::make_unique<chip8[]>(n);
+
+    std::memset(v, 0, sizeof(v));
+    std::memset(index, 0, sizeof(index));
+    std::memset(pc, 0, sizeof(pc));
+    std::memset(delayTimer, 0, sizeof(delayTimer));
+    std::memset(soundTimer, 0, sizeof(soundTimer));
+    std::memset(keys, 0, sizeof(keys));
+    std::memset(rng, 0, sizeof(rng));
+    std::memset(cycle, 0, sizeof(cycle));
+    std::memset(nextTick, 0, sizeof(nextTick));
+    std::memset(ticks, 0, sizeof(ticks));
+    std::memset(tickBase, 0, sizeof(tickBase));
+    std::memset(hz, 0, sizeof(hz));
+    std::fill(quirks, quirks + LANES, quirkProfile::chip8);
+    std::memset(live, 0, sizeof(live));
+    std::memset(untilEvent, 0, sizeof(untilEvent));
+    std::memset(eventSpan, 0, sizeof(eventSpan));
+    std::memset(left, 0, sizeof(left));
+    std::memset(running, 0, sizeof(running));
+    std::memset(detached, 0, sizeof(detached));
+    std::memset(verified, 0, sizeof(verified));
+}
+
+// Copy V (the registers in the mask), I and PC between the columns and
+// the lane's core, around a run of the core's handlers
+void lockstepBatch::gather(size_t l, uint16_t registers) {
+    const chip8& c = lanes[l];
+    for (int r = 0; r < 16; ++r) {
+        if (registers & (1 << r))
+            v[r][l] = c.V[r];
+    }
+    index[l] = c.I;
+    pc[l] = c.pc;
+}
+
+void lockstepBatch::scatter(size_t l, uint16_t registers) {
+    chip8& c = lanes[l];
+    for (int r = 0; r < 16; ++r) {
+        if (registers & (1 << r))
+            c.V[r] = v[r][l];
+    }
+    c.I = index[l];
+    c.pc = pc[l];
+}
+
+// Everything the columns hold, from and to the lane's core
+void lockstepBatch::gatherAll(size_t l) {
+    const chip8& c = lanes[l];
+    gather(l, 0xFFFF);
+
+    delayTimer[l] = c.delay_timer;
+    soundTimer[l] = c.sound_timer;
+    keys[l] = 0;
+    for (int k = 0; k < 16; ++k)
+        keys[l] |= static_cast<uint16_t>((c.key[k] != 0) << k);
+    rng[l] = c.rngState;
+
+    cycle[l] = c.cycleCount;
+    nextTick[l] = c.nextTickCycle;
+    ticks[l] = c.ticksSinceBase;
+    tickBase[l] = c.tickBaseCycle;
+    hz[l] = c.cpuHz;
+
+    quirks[l] = c.quirks;
+    live[l] = !c.faulted;
+}
+
+// The cores are a copy of the columns, so this is const like getLane()
+void lockstepBatch::scatterAll(size_t l) const {
+    chip8& c = lanes[l];
+    for (int r = 0; r < 16; ++r)
+        c.V[r] = v[r][l];
+    c.I = index[l];
+    c.pc = pc[l];
+
+    c.delay_timer = delayTimer[l];
+    c.sound_timer = soundTimer[l];
+    c.setKeys(keys[l]);
+    c.rngState = rng[l];
+
+    c.cycleCount = cycle[l];
+    c.nextTickCycle = nextTick[l];
+    c.ticksSinceBase = ticks[l];
+}
+
+// Bring every core up to date with the columns
+void lockstepBatch::flush() const {
+    if (!dirty)
+        return;
+    for (size_t l = 0; l < count; ++l)
+        scatterAll(l);
+    dirty = false;
+}
+
+chip8& lockstepBatch::lane(size_t l) {
+    flush();
+    stale = true;
+    synced = false;
+    return lanes[l];
+}
+
+const chip8& lockstepBatch::getLane(size_t l) const {
+    flush();
+    return lanes[l];
+}
+
+void lockstepBatch::setKeys(size_t l, uint16_t mask) {
+    keys[l] = mask;
+    if (!synced)
+        lanes[l].setKeys(mask);
+}
+
+// One 60 Hz timer tick of the lane (chip8::catchUpTimers)
+void lockstepBatch::tick(size_t l) {
+    if (delayTimer[l] > 0)
+        --delayTimer[l];
+    if (soundTimer[l] > 0)
+        --soundTimer[l];
+    ++ticks[l];
+    nextTick[l] = chip8::tickCycle(tickBase[l], ticks[l] + 1, hz[l]);
+}
+
+// Start the countdown to the lane's next tick or the end of its budget
+void lockstepBatch::arm(size_t l) {
+    uint64_t toTick = nextTick[l] - cycle[l];
+    eventSpan[l] = static_cast<uint32_t>(std::min<uint64_t>(left[l], toTick));
+    untilEvent[l] = eventSpan[l];
+}
+
+// Count the cycles run since arm(), ticking the timers if that reached
+// a tick
+void lockstepBatch::settle(size_t l) {
+    uint32_t spent = eventSpan[l] - untilEvent[l];
+
+    cycle[l] += spent;
+    left[l] -= spent;
+    eventSpan[l] = untilEvent[l];
+    while (cycle[l] >= nextTick[l])
+        tick(l);
+}
+
+// Take a lane out of lockstep; it finishes the slice on its own core
+void lockstepBatch::detach(size_t l) {
+    settle(l);
+    running[l] = 0;
+    detached[l] = true;
+    stale = true;
+}
+
+// Make sure every attached lane holds the leader's instruction at `addr`.
+// Lanes that don't are detached.
+void lockstepBatch::verify(uint16_t addr, size_t leader) {
+    const chip8& ref = lanes[leader];
+    uint16_t next = (addr + 1) & 0x0FFF;
+
+    for (size_t l = 0; l < count; ++l) {
+        if (l == leader || detached[l])
+            continue;
+
+        const chip8& c = lanes[l];
+        if (c.memory[addr] == ref.memory[addr] && c.memory[next] == ref.memory[next])
+            continue;
+
+        if (running[l]) {
+            detach(l);
+        } else {
+            detached[l] = true;
+            stale = true;
+        }
+    }
+    verified[addr] = true;
+}
+
+// Registers a handler run for the lanes may touch: all of them for the
+// range loads and stores, else VX, VY and VF
+static uint16_t touchedRegisters(uint16_t opcode) {
+    uint8_t nn = opcode & 0xFF;
+    if ((opcode >> 12) == 0xF && (nn == 0x55 || nn == 0x65))
+        return 0xFFFF;
+    if ((opcode & 0xF00E) == 0x5002)
+        return 0xFFFF;
+    return static_cast<uint16_t>((1 << ((opcode >> 8) & 0xF)) | (1 << ((opcode >> 4) & 0xF)) | 0x8000);
+}
+
+// After a lane ran a store (FX33, FX55, XO-CHIP 5XY2) from `indexBefore`:
+// code there has to be checked again before it runs in lockstep
+void lockstepBatch::forgetWrites(uint16_t opcode, uint16_t indexBefore) {
+    int length = 0;
+    int x = (opcode >> 8) & 0xF;
+    int y = (opcode >> 4) & 0xF;
+
+    if ((opcode & 0xF0FF) == 0xF033) {
+        length = 3;
+    } else if ((opcode & 0xF0FF) == 0xF055) {
+        length = x + 1;
+    } else if ((opcode & 0xF00F) == 0x5002) {
+        length = (x <= y ? y - x : x - y) + 1;
+    }
+
+    for (int i = 0; i < length; ++i) {
+        uint16_t addr = static_cast<uint16_t>(indexBefore + i);
+        if (addr < CODE_SIZE) {
+            verified[addr] = false;
+            verified[(addr - 1) & 0x0FFF] = false;
+        }
+    }
+}
+
+// After lane l stored to memory at I for `opcode`: the same bookkeeping
+// as the core's own handlers, plus the batch's
+template <typename Q>
+void lockstepBatch::wroteData(size_t l, uint16_t opcode) {
+    chip8& c = lanes[l];
+    uint16_t addr = index[l];
+    int length = (opcode & 0xFF) == 0x33 ? 3 : ((opcode >> 8) & 0xF) + 1;
+
+    c.markLive(addr, length);
+    if (!(Q::xoChip && addr >= CODE_SIZE && addr + static_cast<size_t>(length) <= MEMORY_SIZE))
+        c.invalidateCode(addr, length);
+    forgetWrites(opcode, addr);
+}
+
+/* -------------------- RUN -------------------- */
+
+uint64_t lockstepBatch::runFor(uint64_t cycles) {
+    uint64_t total = 0;
+    while (cycles > 0) {
+        uint64_t part = std::min(cycles, PATH_SLICE);
+        cycles -= part;
+
+        // Profiling and fuzzing builds detach every lane anyway
+        if (SCALAR_ONLY || !adaptive) {
+            total += runBatch(part);
+            continue;
+        }
+
+        if (phase == pathPhase::run) {
+            total += separateFaster ? runSeparately(part) : runBatch(part);
+            if (--phaseLeft == 0) {
+                phase = pathPhase::timeSeparate;
+                phaseLeft = TIMED_RUNS + (separateFaster ? 0 : 1);
+            }
+            continue;
+        }
+
+        // Both paths give the same results, so timing only picks the
+        // speed. The first run after switching paths re-syncs the
+        // columns or the cores and is left out.
+        bool separate = phase == pathPhase::timeSeparate;
+        if (phaseLeft > TIMED_RUNS) {
+            total += separate ? runSeparately(part) : runBatch(part);
+            --phaseLeft;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t ran = separate ? runSeparately(part) : runBatch(part);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        total += ran;
+        if (separate) {
+            separateNs += ns;
+            separateRan += ran;
+        } else {
+            batchNs += ns;
+            batchRan += ran;
+        }
+
+        if (--phaseLeft > 0)
+            continue;
+        if (separate) {
+            phase = pathPhase::timeBatch;
+            phaseLeft = TIMED_RUNS + 1;
+            continue;
+        }
+
+        // ns per lane instruction, compared without dividing
+        bool faster = separateNs * static_cast<double>(batchRan) < batchNs * static_cast<double>(separateRan);
+        runLength = faster == separateFaster ? std::min(runLength * 2, MAX_RUN_LENGTH) : MIN_RUN_LENGTH;
+        separateFaster = faster;
+        separateNs = batchNs = 0.0;
+        separateRan = batchRan = 0;
+        phase = pathPhase::run;
+        phaseLeft = runLength;
+    }
+    return total;
+}
+
+// Every lane runs on its own core, as if it were not in a batch
+uint64_t lockstepBatch::runSeparately(uint64_t cycles) {
+    // setKeys() only reaches the columns while they are in sync
+    if (synced) {
+        for (size_t l = 0; l < count; ++l)
+            scatterAll(l);
+    }
+    dirty = false;
+
+    uint64_t total = 0;
+    for (size_t l = 0; l < count; ++l)
+        total += lanes[l].runFor(cycles);
+
+    // The columns are behind now, and the code may have changed
+    synced = false;
+    stale = true;
+    counters.scalarSteps += total;
+    ++counters.separateRuns;
+    return total;
+}
+
+uint64_t lockstepBatch::runBatch(uint64_t cycles) {
+    // The first live lane's profile picks the kernels; lanes on another
+    // profile run on their own
+    if (!synced) {
+        for (size_t l = 0; l < count; ++l)
+            gatherAll(l);
+        synced = true;
+    }
+
+    quirkProfile profile = quirks[0];
+    for (size_t l = 0; l < count; ++l) {
+        if (live[l]) {
+            profile = quirks[l];
+            break;
+        }
+    }
+
+    uint64_t total = 0;
+    while (cycles > 0) {
+        uint32_t slice = static_cast<uint32_t>(std::min(cycles, MAX_SLICE));
+
+        switch (profile) {
+            case quirkProfile::legacy: total += runSlice<legacyQuirks>(slice, profile); break;
+            case quirkProfile::chip8:  total += runSlice<chip8Quirks>(slice, profile); break;
+            case quirkProfile::schip:  total += runSlice<schipQuirks>(slice, profile); break;
+            case quirkProfile::xochip: total += runSlice<xochipQuirks>(slice, profile); break;
+        }
+        cycles -= slice;
+    }
+    dirty = true;
+    return total;
+}
+
+template <typename Q>
+uint64_t lockstepBatch::runSlice(uint32_t cycles, quirkProfile profile) {
+    if (stale) {
+        std::memset(verified, 0, sizeof(verified));
+        stale = false;
+    }
+
+    for (size_t l = 0; l < LANES; ++l) {
+        running[l] = 0;
+        detached[l] = false;
+        left[l] = cycles;
+    }
+
+    for (size_t l = 0; l < count; ++l) {
+        if (!live[l])
+            continue;
+
+        if (SCALAR_ONLY || quirks[l] != profile || lanes[l].getDebugger()) {
+            detached[l] = true;
+            continue;
+        }
+
+        while (cycle[l] >= nextTick[l])
+            tick(l);
+        running[l] = 0xFF;
+        arm(l);
+    }
+
+    alignas(64) uint8_t m[LANES];
+    alignas(64) uint8_t taken[LANES];
+    alignas(64) uint8_t result[LANES];
+    alignas(64) uint8_t carry[LANES];
+    alignas(64) uint16_t wideResult[LANES];
+
+    for (;;) {
+        // The group is every lane at the lowest PC. Lanes further ahead
+        // wait for it, so lanes that split at a skip meet again.
+        // (PCs are compared biased by 0x8000, as SSE2 only has a signed
+        // 16-bit min; cycle counts stay below 2^31 for the same reason.)
+        uint8_t any = 0;
+        int16_t lowestKey = INT16_MAX;
+        for (size_t l = 0; l < LANES; ++l) {
+            int16_t key = pcKey(pc[l], running[l]);
+            lowestKey = key < lowestKey ? key : lowestKey;
+            any |= running[l];
+        }
+        if (!any)
+            break;
+        uint16_t lowest = static_cast<uint16_t>(lowestKey ^ 0x8000);
+
+        for (size_t l = 0; l < LANES; ++l)
+            m[l] = running[l] & flag(pc[l] == lowest);
+
+        int16_t waitingKey = INT16_MAX;   // lowest PC outside the group
+        int32_t budget = INT32_MAX;       // steps until a lane in the group has an event
+        for (size_t l = 0; l < LANES; ++l) {
+            int16_t key = pcKey(pc[l], static_cast<uint8_t>(running[l] & ~m[l]));
+            waitingKey = key < waitingKey ? key : waitingKey;
+        }
+        for (size_t l = 0; l < LANES; ++l) {
+            int32_t in = static_cast<int8_t>(m[l]);
+            int32_t events = (static_cast<int32_t>(untilEvent[l]) & in) | (INT32_MAX & ~in);
+            budget = events < budget ? events : budget;
+        }
+        uint16_t waiting = static_cast<uint16_t>(waitingKey ^ 0x8000);
+
+        size_t leader = 0;
+        while (!m[leader])
+            ++leader;
+        const chip8& lead = lanes[leader];
+
+        // Run the group like one lane through straight-line code and
+        // jumps, keeping its PC here instead of in the column, until it
+        // splits, needs the core's handlers, reaches a waiting lane or
+        // runs out of budget
+        uint16_t at = lowest;
+        int32_t steps = 0;
+        bool perLanePc = false;
+        bool faultedNow = false;
+
+        while (steps < budget) {
+            uint16_t addr = at & 0x0FFF;
+            uint16_t opcode = lead.fetch(addr);
+            laneFlow flow = flowOf(opcode);
+
+            // Code the batch hasn't run yet gets checked against every
+            // lane first (and, for an XO-CHIP skip, the word it may skip).
+            // Detaching settles a lane's count, so only at a group's start.
+            uint16_t skipped = (addr + 2) & 0x0FFF;
+            bool xoSkip = Q::xoChip && flow == laneFlow::split && opcode != 0x00EE
+                          && (opcode >> 12) != 0xB;
+            if (!verified[addr] || (xoSkip && !verified[skipped])) {
+                if (steps > 0)
+                    break;
+                if (!verified[addr])
+                    verify(addr, leader);
+                if (xoSkip && !verified[skipped])
+                    verify(skipped, leader);
+                for (size_t l = 0; l < LANES; ++l)
+                    m[l] &= running[l];
+            }
+
+            uint8_t x = (opcode >> 8) & 0xF;
+            uint8_t y = (opcode >> 4) & 0xF;
+            uint8_t nn = opcode & 0xFF;
+            uint16_t nnn = opcode & 0x0FFF;
+            ++steps;
+
+            // Faults are left to the handlers: if any lane would hit a full
+            // or empty stack, a key above 0xF or (classic profiles) memory
+            // past 0xFFF, the whole group takes the handler path
+            if (flow == laneFlow::call || opcode == 0x00EE) {
+                uint16_t limit = flow == laneFlow::call ? 16 : 0;
+                for (size_t l = 0; l < count; ++l) {
+                    if (m[l] && lanes[l].sp == limit)
+                        flow = laneFlow::fallback;
+                }
+            } else if ((opcode >> 12) == 0xE && flow == laneFlow::split) {
+                uint8_t bad = 0;
+                for (size_t l = 0; l < LANES; ++l)
+                    bad |= m[l] & flag(v[x][l] > 0xF);
+                if (bad)
+                    flow = laneFlow::fallback;
+            } else if ((opcode >> 12) == 0xF && (nn == 0x33 || nn == 0x55 || nn == 0x65) && !Q::xoChip) {
+                unsigned length = nn == 0x33 ? 3 : x + 1;
+                for (size_t l = 0; l < count; ++l) {
+                    if (m[l] && index[l] + length > CODE_SIZE)
+                        flow = laneFlow::fallback;
+                }
+            }
+
+            if (flow == laneFlow::call) {
+                for (size_t l = 0; l < count; ++l) {
+                    if (m[l]) {
+                        chip8& c = lanes[l];
+                        c.stack[c.sp++] = static_cast<uint16_t>(at + 2);
+                    }
+                }
+                flow = laneFlow::jump;
+            }
+
+            if (flow == laneFlow::jump) {
+                at = nnn;
+                if (at == waiting)
+                    break;
+                continue;
+            }
+
+            if (flow == laneFlow::next) {
+                switch (opcode >> 12) {
+                    case 0x6:
+                        for (size_t l = 0; l < LANES; ++l)
+                            result[l] = nn;
+                        blend8(v[x], result, m);
+                        break;
+
+                    case 0x7:
+                        for (size_t l = 0; l < LANES; ++l)
+                            v[x][l] = static_cast<uint8_t>(v[x][l] + (nn & m[l]));
+                        break;
+
+                    case 0x8:
+                        // VF is read and written in the handler's order, so
+                        // X or Y = F ends up the same: 8XY4/6/E read both
+                        // operands before setting VF, 8XY5/7 set VF first
+                        // and then subtract with it
+                        switch (opcode & 0xF) {
+                            case 0x0:
+                                blend8(v[x], v[y], m);
+                                break;
+                            case 0x1:
+                                for (size_t l = 0; l < LANES; ++l)
+                                    result[l] = v[x][l] | v[y][l];
+                                blend8(v[x], result, m);
+                                break;
+                            case 0x2:
+                                for (size_t l = 0; l < LANES; ++l)
+                                    result[l] = v[x][l] & v[y][l];
+                                blend8(v[x], result, m);
+                                break;
+                            case 0x3:
+                                for (size_t l = 0; l < LANES; ++l)
+                                    result[l] = v[x][l] ^ v[y][l];
+                                blend8(v[x], result, m);
+                                break;
+                            case 0x4:
+                                for (size_t l = 0; l < LANES; ++l) {
+                                    result[l] = static_cast<uint8_t>(v[x][l] + v[y][l]);
+                                    carry[l] = result[l] < v[x][l];
+                                }
+                                blend8(v[0xF], carry, m);
+                                blend8(v[x], result, m);
+                                break;
+                            case 0x5:
+                                for (size_t l = 0; l < LANES; ++l)
+                                    carry[l] = v[x][l] >= v[y][l];
+                                blend8(v[0xF], carry, m);
+                                for (size_t l = 0; l < LANES; ++l)
+                                    result[l] = static_cast<uint8_t>(v[x][l] - v[y][l]);
+                                blend8(v[x], result, m);
+                                break;
+                            case 0x7:
+                                for (size_t l = 0; l < LANES; ++l)
+                                    carry[l] = v[y][l] >= v[x][l];
+                                blend8(v[0xF], carry, m);
+                                for (size_t l = 0; l < LANES; ++l)
+                                    result[l] = static_cast<uint8_t>(v[y][l] - v[x][l]);
+                                blend8(v[x], result, m);
+                                break;
+                            case 0x6:
+                                for (size_t l = 0; l < LANES; ++l) {
+                                    uint8_t value = Q::shiftUsesVY ? v[y][l] : v[x][l];
+                                    result[l] = value >> 1;
+                                    carry[l] = value & 1;
+                                }
+                                blend8(v[0xF], carry, m);
+                                blend8(v[x], result, m);
+                                break;
+                            case 0xE:
+                                for (size_t l = 0; l < LANES; ++l) {
+                                    uint8_t value = Q::shiftUsesVY ? v[y][l] : v[x][l];
+                                    result[l] = static_cast<uint8_t>(value << 1);
+                                    carry[l] = value >> 7;
+                                }
+                                blend8(v[0xF], carry, m);
+                                blend8(v[x], result, m);
+                                break;
+                        }
+                        if constexpr (Q::logicResetsVF) {
+                            uint8_t n = opcode & 0xF;
+                            if (n >= 0x1 && n <= 0x3) {
+                                for (size_t l = 0; l < LANES; ++l)
+                                    v[0xF][l] &= static_cast<uint8_t>(~m[l]);
+                            }
+                        }
+                        break;
+
+                    case 0xA:
+                        fill16(index, nnn, m);
+                        break;
+
+                    case 0xC:
+                        // Each lane's own random stream
+                        for (size_t l = 0; l < count; ++l) {
+                            if (m[l])
+                                v[x][l] = chip8::nextRandom(rng[l]) & nn;
+                        }
+                        break;
+
+                    case 0xF:
+                        switch (nn) {
+                            case 0x07:
+                                blend8(v[x], delayTimer, m);
+                                break;
+                            case 0x15:
+                                blend8(delayTimer, v[x], m);
+                                break;
+                            case 0x18:
+                                blend8(soundTimer, v[x], m);
+                                break;
+                            case 0x1E:
+                                for (size_t l = 0; l < LANES; ++l) {
+                                    uint16_t sum = static_cast<uint16_t>(index[l] + v[x][l]);
+                                    carry[l] = sum > 0x0FFF;
+                                    wideResult[l] = Q::xoChip ? sum : sum & 0x0FFF;
+                                }
+                                if constexpr (Q::indexOverflowFlag)
+                                    blend8(v[0xF], carry, m);
+                                blend16(index, wideResult, m);
+                                break;
+                            case 0x29:
+                                for (size_t l = 0; l < LANES; ++l)
+                                    wideResult[l] = static_cast<uint16_t>(0x50 + (v[x][l] & 0x0F) * 5);
+                                blend16(index, wideResult, m);
+                                break;
+
+                            // Memory is each lane's own
+                            case 0x33:
+                                for (size_t l = 0; l < count; ++l) {
+                                    if (!m[l])
+                                        continue;
+                                    uint8_t value = v[x][l];
+                                    uint8_t* memory = lanes[l].memory;
+                                    memory[dataAddr<Q>(index[l])] = value / 100;
+                                    memory[dataAddr<Q>(index[l] + 1)] = (value / 10) % 10;
+                                    memory[dataAddr<Q>(index[l] + 2)] = value % 10;
+                                    wroteData<Q>(l, opcode);
+                                }
+                                break;
+                            case 0x55:
+                                for (size_t l = 0; l < count; ++l) {
+                                    if (!m[l])
+                                        continue;
+                                    uint8_t* memory = lanes[l].memory;
+                                    for (int r = 0; r <= x; ++r)
+                                        memory[dataAddr<Q>(index[l] + r)] = v[r][l];
+                                    wroteData<Q>(l, opcode);
+                                    if constexpr (Q::loadStoreIncrementsI)
+                                        index[l] = dataAddr<Q>(index[l] + x + 1);
+                                }
+                                break;
+                            case 0x65:
+                                for (size_t l = 0; l < count; ++l) {
+                                    if (!m[l])
+                                        continue;
+                                    const uint8_t* memory = lanes[l].memory;
+                                    for (int r = 0; r <= x; ++r)
+                                        v[r][l] = memory[dataAddr<Q>(index[l] + r)];
+                                    if constexpr (Q::loadStoreIncrementsI)
+                                        index[l] = dataAddr<Q>(index[l] + x + 1);
+                                }
+                                break;
+                        }
+                        break;
+                }
+
+                at += 2;
+                if (at == waiting)
+                    break;
+                continue;
+            }
+
+            // From here each lane has its own PC again
+            fill16(pc, at, m);
+            perLanePc = true;
+
+            if (flow == laneFlow::split) {
+                uint8_t skip = Q::xoChip && lead.fetch(skipped) == 0xF000 ? 6 : 4;
+
+                switch (opcode >> 12) {
+                    case 0x0:
+                        for (size_t l = 0; l < count; ++l) {
+                            if (m[l]) {
+                                chip8& c = lanes[l];
+                                pc[l] = c.stack[--c.sp];
+                            }
+                        }
+                        break;
+                    case 0x3:
+                        for (size_t l = 0; l < LANES; ++l)
+                            taken[l] = flag(v[x][l] == nn);
+                        skipIf(pc, taken, skip, m);
+                        break;
+                    case 0x4:
+                        for (size_t l = 0; l < LANES; ++l)
+                            taken[l] = flag(v[x][l] != nn);
+                        skipIf(pc, taken, skip, m);
+                        break;
+                    case 0x5:
+                        for (size_t l = 0; l < LANES; ++l)
+                            taken[l] = flag(v[x][l] == v[y][l]);
+                        skipIf(pc, taken, skip, m);
+                        break;
+                    case 0x9:
+                        for (size_t l = 0; l < LANES; ++l)
+                            taken[l] = flag(v[x][l] != v[y][l]);
+                        skipIf(pc, taken, skip, m);
+                        break;
+                    case 0xE:
+                        for (size_t l = 0; l < LANES; ++l)
+                            taken[l] = flag(((keys[l] >> (v[x][l] & 0xF)) & 1) == (nn == 0x9E));
+                        skipIf(pc, taken, skip, m);
+                        break;
+                    case 0xB: {
+                        const uint8_t* offset = Q::jumpUsesVX ? v[x] : v[0];
+                        for (size_t l = 0; l < LANES; ++l)
+                            wideResult[l] = static_cast<uint16_t>(nnn + offset[l]);
+                        blend16(pc, wideResult, m);
+                        break;
+                    }
+                }
+                break;
+            }
+
+            // Everything else runs lane by lane through the core's handler.
+            // Handlers only use the registers, I, PC and (FX0A, EX9E/EXA1
+            // with a bad key) the keypad of the state kept in the columns.
+            decodedOp op = lead.decoder(opcode);
+            uint16_t registers = touchedRegisters(opcode);
+            bool readsKeys = (opcode >> 12) == 0xE || (opcode & 0xF0FF) == 0xF00A;
+            for (size_t l = 0; l < count; ++l) {
+                if (!m[l])
+                    continue;
+
+                chip8& c = lanes[l];
+                uint16_t indexBefore = index[l];
+                scatter(l, registers);
+                if (readsKeys)
+                    c.setKeys(keys[l]);
+                op.handler(c, op);
+                gather(l, registers);
+
+                forgetWrites(opcode, indexBefore);
+                if (c.faulted) {
+                    live[l] = false;
+                    faultedNow = true;
+                }
+                ++counters.fallbackSteps;
+            }
+            break;
+        }
+
+        if (!perLanePc)
+            fill16(pc, at, m);
+
+        // Charge the steps to every lane in the group; lanes that reached
+        // a timer tick, the end of the slice or a fault get settled
+        uint32_t lanesInGroup = 0;
+        uint8_t due = 0;
+        for (size_t l = 0; l < LANES; ++l) {
+            lanesInGroup += m[l] & 1;
+            untilEvent[l] -= static_cast<uint32_t>(steps) & static_cast<uint32_t>(static_cast<int8_t>(m[l]));
+            due |= running[l] & flag(untilEvent[l] == 0);
+        }
+        counters.steps += steps;
+        counters.laneSteps += static_cast<uint64_t>(steps) * lanesInGroup;
+
+        if (due || faultedNow) {
+            for (size_t l = 0; l < count; ++l) {
+                if (!running[l] || (untilEvent[l] != 0 && live[l]))
+                    continue;
+
+                settle(l);
+                if (left[l] == 0 || !live[l]) {
+                    running[l] = 0;
+                } else {
+                    arm(l);
+                }
+            }
+        }
+    }
+
+    // Detached lanes finish on their own
+    uint64_t total = 0;
+    for (size_t l = 0; l < count; ++l) {
+        if (detached[l] && left[l] > 0 && live[l]) {
+            scatterAll(l);
+            uint64_t ran = lanes[l].runFor(left[l]);
+            counters.scalarSteps += ran;
+            left[l] -= static_cast<uint32_t>(ran);
+            gatherAll(l);
+        }
+        total += cycles - left[l];
+    }
+    return total;
+}
@@ -0,0 +1,170 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_LOCKSTEP_HPP
+#define CHIP8_EMULATOR_LOCKSTEP_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Where a lockstepBatch's instructions went
+struct lockstepStats {
+    uint64_t steps = 0;         // instructions issued for a group of lanes
+    uint64_t laneSteps = 0;     // lane instructions in those groups
+    uint64_t fallbackSteps = 0; // of those, run lane by lane through the core's handlers
+    uint64_t scalarSteps = 0;   // lane instructions run on a lane's own core
+    uint64_t separateRuns = 0;  // runs handed to every lane's own core (see runFor)
+
+    // Average lanes per issued instruction
+    double occupancy() const { return steps ? static_cast<double>(laneSteps) / steps : 0.0; }
+};
+
+/*
+    Up to LANES emulators of the same ROM (different seeds, different
+    inputs) run side by side, for Monte-Carlo style testing.
+
+    V, I, PC, the timers, the keypad, the random generator and the
+    scheduler counters of every lane live in structure-of-arrays columns
+    in the batch. Each step picks the lowest PC among the lanes and issues
+    its instruction once for every lane sitting at that PC; the other
+    lanes are masked out and catch up on later steps, so lanes that split
+    at a skip meet again where the paths join. ALU ops, loads, timers,
+    keys, skips and jumps are fixed-width loops over the columns, which
+    the compiler turns into SSE/AVX2/NEON code for the target (or plain
+    scalar code). Memory, the display and the stack stay in each lane's
+    core; stores, calls and returns touch them lane by lane, and anything
+    else (drawing, FX0A, SCHIP/XO-CHIP extras) runs through the core's own
+    handlers.
+
+    The batch only wins when many lanes share straight-line code: with
+    few lanes, or lanes that split at skips, or mostly drawing, the
+    per-step bookkeeping costs more than the shared issue saves. Lane
+    occupancy alone does not tell (calls keep every lane together and
+    still lose at 8 lanes), so runFor() times both ways now and then and
+    otherwise hands the run to each lane's own runFor() when that is
+    faster (see chip8_bench --lanes).
+
+    Results are exactly those of calling runFor() on each lane on its own,
+    timer ticks and faults included. A lane is detached, and finishes the
+    run on its own core, if its quirk profile differs from the others or
+    it runs code that differs from theirs (self-modifying code).
+    Profiling and fuzzing builds run every lane on its own core, so their
+    hooks see every instruction; so does a lane with a debugger attached.
+
+    The cores are brought up to date from the columns when a lane is
+    looked at (getLane(), lane()), not after every run.
+    Not thread-safe; run one batch per thread.
+*/
+class lockstepBatch {
+
+public:
+    static constexpr size_t LANES = 32;
+
+private:
+    std::unique_ptr<chip8[]> lanes;
+    size_t count;
+
+    // Lane state, one column per lane
+    alignas(64) uint8_t v[16][LANES];
+    alignas(64) uint16_t index[LANES];
+    alignas(64) uint16_t pc[LANES];
+    alignas(64) uint8_t delayTimer[LANES];
+    alignas(64) uint8_t soundTimer[LANES];
+    alignas(64) uint16_t keys[LANES];
+    uint64_t rng[LANES];
+
+    // The lanes' schedulers (see chip8::runFor)
+    uint64_t cycle[LANES];
+    uint64_t nextTick[LANES];
+    uint64_t ticks[LANES];
+    uint64_t tickBase[LANES];
+    uint32_t hz[LANES];
+
+    quirkProfile quirks[LANES];
+    bool live[LANES];            // not faulted
+
+    // Cycles to the lane's next timer tick or the end of its budget,
+    // whichever comes first, and what that countdown started from
+    alignas(64) uint32_t untilEvent[LANES];
+    uint32_t eventSpan[LANES];
+    uint32_t left[LANES];        // cycles still to run in this slice
+
+    alignas(64) uint8_t running[LANES];  // 0xFF = running in lockstep
+    bool detached[LANES];
+
+    // Code addresses every attached lane holds the same instruction at
+    // (both bytes). Checked the first time each address runs, and
+    // forgotten when a lane writes there.
+    bool verified[CODE_SIZE];
+    bool stale;
+
+    // The columns hold every lane's state (false once a lane was handed
+    // out for changes), and the cores are behind the columns
+    bool synced;
+    mutable bool dirty;
+
+    lockstepStats counters;
+
+    // Whether runFor() uses the columns or each lane's own runFor(): both
+    // are timed for a few runs, then the faster one runs until the next
+    // check. Checks that agree with the last one come less often.
+    enum class pathPhase { timeSeparate, timeBatch, run };
+    pathPhase phase;
+    uint32_t phaseLeft;
+    uint32_t runLength;
+    bool separateFaster;
+    bool adaptive;
+    double separateNs, batchNs;
+    uint64_t separateRan, batchRan;
+
+    void gather(size_t l, uint16_t registers);
+    void scatter(size_t l, uint16_t registers);
+    void gatherAll(size_t l);
+    void scatterAll(size_t l) const;
+    void flush() const;
+
+    void tick(size_t l);
+    void arm(size_t l);
+    void settle(size_t l);
+    void detach(size_t l);
+    void verify(uint16_t addr, size_t leader);
+    void forgetWrites(uint16_t opcode, uint16_t indexBefore);
+
+    template <typename Q>
+    void wroteData(size_t l, uint16_t opcode);
+
+    template <typename Q>
+    uint64_t runSlice(uint32_t cycles, quirkProfile profile);
+    uint64_t runBatch(uint64_t cycles);
+    uint64_t runSeparately(uint64_t cycles);
+
+public:
+    explicit lockstepBatch(size_t lanes = LANES);
+
+    size_t size() const { return count; }
+
+    // Set a lane up (loadROM, seed, setQuirks, loadState, ...). This may
+    // change the lane's code, so the next run checks it again.
+    chip8& lane(size_t l);
+
+    // Read a lane's state
+    const chip8& getLane(size_t l) const;
+
+    void setKeys(size_t l, uint16_t mask);
+
+    // Run every lane for `cycles` instructions (less for a lane that
+    // faults). Returns the number of lane instructions run.
+    uint64_t runFor(uint64_t cycles);
+
+    // Let runFor() pick the faster path (the default), or keep it on the
+    // columns, e.g. to check them against separate cores
+    void setAdaptive(bool on) { adaptive = on; }
+
+    const lockstepStats& stats() const { return counters; }
+    void resetStats() { counters = lockstepStats(); }
+};
+
+#endif // CHIP8_EMULATOR_LOCKSTEP_HPP
@@ -1,20 +1,483 @@
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
+#include "capture.hpp"
 #include "chip8.hpp"
+#include "debugger.hpp"
+#include "movie.hpp"
+#include "rewind.hpp"
+#include "triple_buffer.hpp"
+#include <fstream>
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void printUsage() {
+    std::cerr << "Usage: chip8_emulator [rom] [--hz cpu speed] [--scale pixels] [--speed multiplier]\n"
+              << "                      [--turbo multiplier, 0 = unlimited] [--seed n]\n"
+              << "                      [--record movie | --play movie] [--capture file.c8fc]\n"
+              << "                      [--quirks legacy|chip8|schip|xochip] [--quirk-db file] [--debug]\n"
+              << "Tab: toggle turbo, F5: quick save, F9: quick load, hold Backspace: rewind\n"
+              << "--debug reads debugger commands from the console (help lists them), F10: pause\n";
+}
+
+static void saveStateToFile(const chip8& emulator, const std::string& path) {
+    std::vector<uint8_t> state = emulator.saveState();
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(reinterpret_cast<const char*>(state.data()), state.size())) {
+        throw std::runtime_error("Failed to write save state: " + path);
+    }
+}
+
+static void loadStateFromFile(chip8& emulator, const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open save state: " + path);
+    }
+
+    std::vector<uint8_t> state((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+    emulator.loadState(state);
+}
+
+// A finished frame, handed from the emulation thread to the SDL thread
+struct framePacket {
+    uint64_t rows[2][64][2];    // both planes, same layout as chip8::getPlaneRows()
+    int width;
+    int height;
+};
+
+// What the audio callback should be playing right now
+struct soundPacket {
+    uint8_t pattern[16];    // 128 one-bit samples, most significant bit first
+    double rate = 0.0;      // pattern bits per second, 0 = silent
+};
+
+// Requests from the SDL thread, picked up by the emulation thread
+enum class frontCommand : int {
+    none,
+    saveState,
+    loadState,
+    debugPause
+};
+
+// Debugger commands typed on the console (--debug). The reader thread
+// keeps its own reference: it can't be joined out of getline(), so it
+// may outlive main()'s state.
+struct debugConsole {
+    std::mutex lock;
+    std::deque<std::string> commands;
+};
+
+// Everything the two threads share. No locks on the per-frame path: the
+// SDL thread writes the inputs and the emulation thread writes the
+// outputs. Only debugger commands from the console go through a mutex.
+struct sharedState {
+    // SDL thread -> emulation thread
+    std::atomic<uint16_t> keys{0};          // bit k = key k held
+    std::atomic<bool> turbo{false};
+    std::atomic<bool> rewinding{false};
+    std::atomic<int> command{static_cast<int>(frontCommand::none)};
+    std::atomic<bool> quit{false};
+
+    // Emulation thread -> SDL thread
+    tripleBuffer<framePacket> frames;
+    std::atomic<uint64_t> cycles{0};
+    std::atomic<bool> halted{false};        // paused in the debugger
+
+    // Emulation thread -> audio callback
+    tripleBuffer<soundPacket> sound;
+
+    // Console -> emulation thread (--debug)
+    std::shared_ptr<debugConsole> console = std::make_shared<debugConsole>();
+};
+
+struct emulationSettings {
+    std::string statePath;
+    double speed;
+    double turboSpeed;
+    inputMovie* recording = nullptr;        // live input is appended here
+    const inputMovie* playback = nullptr;   // input comes from here until it ends
+    debugger* debug = nullptr;              // attached to the emulator (--debug)
+    frameCapture* capture = nullptr;        // gets every emulated frame (--capture)
+};
+
+/* -------------------- EMULATION THREAD -------------------- */
+
+static void runEmulation(chip8& emulator, sharedState& shared, const emulationSettings& settings) {
+    using clock = std::chrono::steady_clock;
+
+    // Emulated frames are 1/60 s of emulated time (one timer tick)
+    const double MAX_CATCH_UP_FRAMES = 4.0; // after a stall, don't try to make up more than this
+
+    rewindBuffer history;   // a few minutes of rewind
+    auto lastSnapshot = clock::now();
+    bool forceDraw = true;
+
+    auto lastTime = clock::now();
+    double framesDue = 0.0;
+    bool wasTurbo = false;
+
+    // Unlimited speed runs frames in batches sized to ~1 ms, so input and
+    // published frames are never more than about a millisecond stale
+    uint64_t turboBatch = 1;
+
+    // Rewinding or loading a state would tear the recording's timeline
+    bool recording = settings.recording != nullptr;
+
+    std::unique_ptr<moviePlayer> player;
+    if (settings.playback)
+        player.reset(new moviePlayer(*settings.playback));
+
+    // A rewind snapshot costs far more than a frame, so turbo takes at
+    // most one per 60 Hz frame of real time; none while a movie records
+    // or plays, since rewinding is off then
+    auto snapshot = [&](bool turbo, clock::time_point at) {
+        if (recording || player)
+            return;
+        if (turbo && at - lastSnapshot < std::chrono::microseconds(16667))
+            return;
+        history.push(emulator);
+        lastSnapshot = at;
+    };
+
+    // The capture sees each frame's drawing; publishing it is left to
+    // forceDraw, since batches of frames only publish the last
+    auto captureDisplay = [&] {
+        if (!settings.capture)
+            return;
+        settings.capture->frame(emulator);
+        if (emulator.shouldDraw()) {
+            emulator.resetDrawFlag();
+            forceDraw = true;
+        }
+    };
+
+    auto stepFrame = [&] {
+        if (!player) {
+            emulator.runFrame();
+            captureDisplay();
+            return;
+        }
+
+        uint64_t left = settings.playback->length - emulator.getCycleCount();
+        player->runFor(emulator, std::min(emulator.cyclesUntilFrame(), left));
+        captureDisplay();
+
+        if (player->finished(emulator)) {
+            bool match = emulator.displayHash() == settings.playback->finalHash;
+            std::cerr << "Movie finished at cycle " << emulator.getCycleCount()
+                      << (match ? ", display matches the recording\n" : ", DESYNC: display differs from the recording\n");
+
+            // Hand control back to the keyboard at normal speed
+            player.reset();
+            shared.turbo.store(false);
+        }
+    };
+
+    while (!shared.quit.load(std::memory_order_relaxed)) {
+        if (!player) {
+            uint16_t keys = shared.keys.load(std::memory_order_relaxed);
+            emulator.setKeys(keys);
+            if (recording)
+                settings.recording->record(emulator, keys);
+        }
+
+        /* -------------------- COMMANDS -------------------- */
+        auto command = static_cast<frontCommand>(
+                shared.command.exchange(static_cast<int>(frontCommand::none)));
+        try {
+            if (command == frontCommand::saveState) {
+                saveStateToFile(emulator, settings.statePath);
+            } else if (command == frontCommand::loadState && !recording && !player) {
+                loadStateFromFile(emulator, settings.statePath);
+                history.clear();
+                forceDraw = true;
+            } else if (command == frontCommand::debugPause && settings.debug) {
+                settings.debug->pause();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+        }
+
+        if (settings.debug) {
+            std::deque<std::string> lines;
+            {
+                std::lock_guard<std::mutex> lock(shared.console->lock);
+                lines.swap(shared.console->commands);
+            }
+            for (const std::string& line : lines) {
+                try {
+                    std::cout << settings.debug->command(emulator, line) << std::flush;
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << "\n";
+                }
+            }
+        }
+
+        /* -------------------- CPU -------------------- */
+        bool turbo = shared.turbo.load(std::memory_order_relaxed);
+        bool rewinding = shared.rewinding.load(std::memory_order_relaxed) && !recording && !player;
+        bool halted = settings.debug && settings.debug->isPaused();
+        double multiplier = turbo ? settings.turboSpeed : settings.speed;
+        auto now = clock::now();
+
+        if (turbo != wasTurbo) {
+            framesDue = 0.0;
+            wasTurbo = turbo;
+        }
+
+        shared.halted.store(halted, std::memory_order_relaxed);
+        if (halted) {
+            // Paused in the debugger: no frames owed, nothing to rewind to
+            framesDue = 0.0;
+            multiplier = 1.0;
+        } else if (rewinding) {
+            // Step back one snapshot per frame of real time
+            double elapsed = std::chrono::duration<double>(now - lastTime).count();
+            framesDue += elapsed * 60.0;
+            if (framesDue > MAX_CATCH_UP_FRAMES)
+                framesDue = MAX_CATCH_UP_FRAMES;
+
+            while (framesDue >= 1.0) {
+                history.rewind(emulator);
+                forceDraw = true;
+                framesDue -= 1.0;
+            }
+            multiplier = 1.0;
+        } else if (multiplier > 0.0) {
+            // Owe the emulator however much emulated time has passed,
+            // measured rather than assumed, so the speed doesn't drift
+            double elapsed = std::chrono::duration<double>(now - lastTime).count();
+            framesDue += elapsed * 60.0 * multiplier;
+            if (framesDue > MAX_CATCH_UP_FRAMES * multiplier)
+                framesDue = MAX_CATCH_UP_FRAMES * multiplier;
+
+            while (framesDue >= 1.0) {
+                stepFrame();
+                snapshot(turbo, now);
+                framesDue -= 1.0;
+            }
+        } else {
+            // Unlimited
+            auto batchStart = clock::now();
+            for (uint64_t i = 0; i < turboBatch; ++i)
+                stepFrame();
+
+            auto batchEnd = clock::now();
+            snapshot(true, batchEnd);
+
+            auto batchTime = batchEnd - batchStart;
+            if (batchTime < std::chrono::microseconds(500))
+                turboBatch *= 2;
+            else if (batchTime > std::chrono::milliseconds(2) && turboBatch > 1)
+                turboBatch /= 2;
+        }
+        lastTime = now;
+
+        if (settings.debug && settings.debug->takeStop())
+            std::cout << settings.debug->describeStop(emulator) << std::flush;
+
+        /* -------------------- PUBLISH -------------------- */
+        if (emulator.shouldDraw() || forceDraw) {
+            framePacket& frame = shared.frames.writeBuffer();
+            std::memcpy(frame.rows[0], emulator.getPlaneRows(0), sizeof(frame.rows[0]));
+            std::memcpy(frame.rows[1], emulator.getPlaneRows(1), sizeof(frame.rows[1]));
+            frame.width = emulator.getDisplayWidth();
+            frame.height = emulator.getDisplayHeight();
+            shared.frames.publish();
+
+            emulator.resetDrawFlag();
+            forceDraw = false;
+        }
+        shared.cycles.store(emulator.getCycleCount(), std::memory_order_relaxed);
+
+        /* -------------------- SOUND -------------------- */
+        // The callback plays whatever was published last instead of
+        // queueing samples, so fast-forward can't build up a backlog: a
+        // fixed speed-up raises the pitch, unlimited speed and rewind mute
+        soundPacket& sound = shared.sound.writeBuffer();
+        bool audible = emulator.getSoundTimer() > 0 && !rewinding && !halted && multiplier > 0.0;
+        sound.rate = audible ? emulator.getAudioRate() * multiplier : 0.0;
+        std::memcpy(sound.pattern, emulator.getAudioPattern(), sizeof(sound.pattern));
+        shared.sound.publish();
+
+        /* -------------------- PACING -------------------- */
+        // Sleep until the next emulated frame is due, not a fixed 16 ms
+        if (multiplier > 0.0) {
+            double wait = (1.0 - framesDue) / (60.0 * multiplier);
+            auto wake = lastTime + std::chrono::duration_cast<clock::duration>(
+                    std::chrono::duration<double>(wait));
+            std::this_thread::sleep_until(wake);
+        }
+    }
+}
+
+/* -------------------- AUDIO CALLBACK -------------------- */
+
+// Owned by the audio callback once the device is running
+struct audioState {
+    sharedState* shared;
+    int sampleRate = 48000;
+    uint32_t phase = 0;     // position in the pattern: bit index in the top 7 bits
+};
+
+static void audioCallback(void* userdata, Uint8* stream, int len) {
+    auto* audio = static_cast<audioState*>(userdata);
+    Sint16* out = reinterpret_cast<Sint16*>(stream);
+    int samples = len / static_cast<int>(sizeof(Sint16));
+
+    // Newest published sound state; never waits on the emulation thread
+    audio->shared->sound.fetch();
+    const soundPacket& sound = audio->shared->sound.readBuffer();
+
+    if (sound.rate <= 0.0) {
+        std::memset(stream, 0, len);
+        return;
+    }
+
+    const Sint16 VOLUME = 3000;
+
+    // Pattern bits per output sample, in the same fixed point as phase
+    double bitsPerSample = std::min(sound.rate / audio->sampleRate, 64.0);
+    uint32_t step = static_cast<uint32_t>(bitsPerSample * (1u << 25));
+
+    for (int i = 0; i < samples; ++i) {
+        unsigned bit = audio->phase >> 25;
+        out[i] = ((sound.pattern[bit >> 3] << (bit & 7)) & 0x80) ? VOLUME : -VOLUME;
+        audio->phase += step;
+    }
+}
+
+/* -------------------- SDL THREAD -------------------- */
+
+static uint16_t readKeypad() {
+    const Uint8* keys = SDL_GetKeyboardState(nullptr);
+
+    // CHIP-8 key index -> host scancode
+    static const SDL_Scancode KEYMAP[16] = {
+            SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,  // 0 1 2 3
+            SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,  // 4 5 6 7
+            SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,  // 8 9 A B
+            SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V   // C D E F
+    };
+
+    uint16_t mask = 0;
+    for (int k = 0; k < 16; ++k) {
+        if (keys[KEYMAP[k]])
+            mask |= 1 << k;
+    }
+    return mask;
+}
 
 int main(int argc, char* argv[]) {
     chip8 emulator;
 
+    std::string romPath = "Pong.ch8";
+    int cpuHz = 600;          // instructions per second
+    int scale = 10;           // window pixels per CHIP-8 pixel
+    emulationSettings settings;
+    settings.speed = 1.0;       // normal speed multiplier
+    settings.turboSpeed = 0.0;  // speed while turbo is on, 0 = as fast as possible
+    uint64_t seed = 0;
+    std::string recordPath;
+    std::string playPath;
+    inputMovie movie;
+    std::string quirksName;
+    std::string quirkDbPath = "quirks.db";
+    debugger debug;
+    std::string capturePath;
+    frameCapture capture;   // drops frames rather than hold up emulation
+
     try {
-        emulator.loadROM("Pong.ch8");
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+
+            if (arg == "--hz" && i + 1 < argc) {
+                cpuHz = std::stoi(argv[++i]);
+            } else if (arg == "--scale" && i + 1 < argc) {
+                scale = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--speed" && i + 1 < argc) {
+                settings.speed = std::stod(argv[++i]);
+            } else if (arg == "--turbo" && i + 1 < argc) {
+                settings.turboSpeed = std::stod(argv[++i]);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                seed = std::stoull(argv[++i], nullptr, 0);
+            } else if (arg == "--record" && i + 1 < argc) {
+                recordPath = argv[++i];
+            } else if (arg == "--play" && i + 1 < argc) {
+                playPath = argv[++i];
+            } else if (arg == "--quirks" && i + 1 < argc) {
+                quirksName = argv[++i];
+            } else if (arg == "--quirk-db" && i + 1 < argc) {
+                quirkDbPath = argv[++i];
+            } else if (arg == "--capture" && i + 1 < argc) {
+                capturePath = argv[++i];
+            } else if (arg == "--debug") {
+                settings.debug = &debug;
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else {
+                romPath = arg;
+            }
+        }
+
+        emulator.setCpuHz(cpuHz);
+        emulator.seed(seed);
+        emulator.loadROM(romPath);
+
+        // --quirks wins, then the ROM database (optional unless named), then legacy
+        quirkProfile quirks = quirkProfile::legacy;
+        if (!quirksName.empty()) {
+            if (!parseQuirkProfile(quirksName, quirks))
+                throw std::runtime_error("Unknown quirk profile: " + quirksName);
+        } else if (std::ifstream(quirkDbPath).good()) {
+            quirkDatabase quirkDb;
+            quirkDb.load(quirkDbPath);
+            quirkDb.lookup(emulator.getROMHash(), quirks);
+        }
+        emulator.setQuirks(quirks);
+
+        std::printf("ROM %s, hash %016llX, quirks %s\n", romPath.c_str(),
+                    static_cast<unsigned long long>(emulator.getROMHash()),
+                    quirkProfileName(quirks));
+
+        if (!playPath.empty()) {
+            // The movie decides the seed, speed and quirks
+            movie = inputMovie::load(playPath);
+            moviePlayer(movie).prepare(emulator);
+            settings.playback = &movie;
+        } else if (!recordPath.empty()) {
+            movie.begin(emulator, seed);
+            settings.recording = &movie;
+        }
+
+        if (!capturePath.empty()) {
+            capture.open(capturePath, emulator);
+            settings.capture = &capture;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << "\n";
         return 1;
     }
 
+    emulator.setDispatchMode(dispatchMode::block);
+    emulator.attachDebugger(settings.debug);
+
+    // Quick save slot next to the ROM
+    settings.statePath = romPath + ".state";
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0) {
         std::cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
         return 1;
@@ -24,8 +487,8 @@ int main(int argc, char* argv[]) {
             "CHIP-8 Emulator",
             SDL_WINDOWPOS_CENTERED,
             SDL_WINDOWPOS_CENTERED,
-            64 * 10,
-            32 * 10,
+            64 * scale,
+            32 * scale,
             SDL_WINDOW_SHOWN
     );
 
@@ -35,8 +498,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Vsync only ever stalls this thread, never the emulation thread
     SDL_Renderer* renderer = SDL_CreateRenderer(
-            window, -1, SDL_RENDERER_ACCELERATED
+            window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
     );
 
     if (!renderer) {
@@ -46,11 +510,86 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // The screen lives in one 128 × 64 streaming texture (lo-res uses its
+    // top-left 64 × 32); rows are uploaded only when they change and the
+    // GPU does the scaling
+    SDL_Texture* screen = SDL_CreateTexture(
+            renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 128, 64
+    );
+
+    if (!screen) {
+        std::cerr << "SDL_CreateTexture Error: " << SDL_GetError() << std::endl;
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Colour of each plane 0 / plane 1 bit pair (XO-CHIP draws on both)
+    const Uint32 PALETTE[4] = { 0xFF000000, 0xFFFFFFFF, 0xFF55AAFF, 0xFFFF8800 };
+
+    // Eight texture pixels for every possible plane 0 byte, so uploads
+    // copy 32 bytes at a time instead of testing each pixel. Bytes with
+    // plane 1 bits set go through the palette pixel by pixel.
+    static Uint32 BYTE_PIXELS[256][8];
+    for (int b = 0; b < 256; ++b) {
+        for (int bit = 0; bit < 8; ++bit)
+            BYTE_PIXELS[b][bit] = PALETTE[(b >> (7 - bit)) & 1];
+    }
+
+    sharedState shared;
+    shared.turbo.store(settings.playback != nullptr); // replays run flat out
+
+    // Sound: 256-sample buffers (about 5 ms) keep the latency well under
+    // a frame or two. Without an audio device we just run silent.
+    audioState audio;
+    audio.shared = &shared;
+
+    SDL_AudioSpec want{};
+    SDL_AudioSpec have{};
+    want.freq = 48000;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = 256;
+    want.callback = audioCallback;
+    want.userdata = &audio;
+
+    SDL_AudioDeviceID audioDevice = SDL_OpenAudioDevice(nullptr, 0, &want, &have,
+                                                        SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (audioDevice) {
+        audio.sampleRate = have.freq;
+        SDL_PauseAudioDevice(audioDevice, 0);
+    } else {
+        std::cerr << "No audio: " << SDL_GetError() << "\n";
+    }
+
+    std::thread emulation(runEmulation, std::ref(emulator), std::ref(shared), std::cref(settings));
+
+    // Debugger console. The reader sits in getline() for good, so it is
+    // left behind at exit rather than joined, holding on to the queue.
+    if (settings.debug) {
+        std::cout << "Debugger attached; type help for commands" << std::endl;
+        std::thread([console = shared.console] {
+            for (std::string line; std::getline(std::cin, line);) {
+                std::lock_guard<std::mutex> lock(console->lock);
+                console->commands.push_back(line);
+            }
+        }).detach();
+    }
+
     bool quit = false;
+    bool audioPaused = false;
     SDL_Event e;
 
-    const int CYCLES_PER_FRAME = 10; // ~600 Hz CPU
-    const int FRAME_DELAY_MS = 16;   // ~60 FPS
+    using clock = std::chrono::steady_clock;
+
+    // Rows currently in the texture; new frames are diffed against them
+    uint64_t shownRows[2][64][2];
+    int shownWidth = 0;
+
+    // Cycles-per-second counter for the window title
+    auto statsStart = clock::now();
+    uint64_t statsCycles = 0;
 
     while (!quit) {
 
@@ -58,62 +597,153 @@ int main(int argc, char* argv[]) {
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_QUIT)
                 quit = true;
-        }
 
-        /* -------------------- INPUT -------------------- */
-        const Uint8* keys = SDL_GetKeyboardState(nullptr);
+            if (e.type == SDL_KEYDOWN && !e.key.repeat) {
+                switch (e.key.keysym.scancode) {
+                    case SDL_SCANCODE_TAB:
+                        shared.turbo.store(!shared.turbo.load());
+                        break;
 
-        emulator.setKey(0x1, keys[SDL_SCANCODE_1]);
-        emulator.setKey(0x2, keys[SDL_SCANCODE_2]);
-        emulator.setKey(0x3, keys[SDL_SCANCODE_3]);
-        emulator.setKey(0xC, keys[SDL_SCANCODE_4]);
+                    case SDL_SCANCODE_F5:
+                        shared.command.store(static_cast<int>(frontCommand::saveState));
+                        break;
 
-        emulator.setKey(0x4, keys[SDL_SCANCODE_Q]);
-        emulator.setKey(0x5, keys[SDL_SCANCODE_W]);
-        emulator.setKey(0x6, keys[SDL_SCANCODE_E]);
-        emulator.setKey(0xD, keys[SDL_SCANCODE_R]);
+                    case SDL_SCANCODE_F9:
+                        shared.command.store(static_cast<int>(frontCommand::loadState));
+                        break;
 
-        emulator.setKey(0x7, keys[SDL_SCANCODE_A]);
-        emulator.setKey(0x8, keys[SDL_SCANCODE_S]);
-        emulator.setKey(0x9, keys[SDL_SCANCODE_D]);
-        emulator.setKey(0xE, keys[SDL_SCANCODE_F]);
+                    case SDL_SCANCODE_F10:
+                        shared.command.store(static_cast<int>(frontCommand::debugPause));
+                        break;
 
-        emulator.setKey(0xA, keys[SDL_SCANCODE_Z]);
-        emulator.setKey(0x0, keys[SDL_SCANCODE_X]);
-        emulator.setKey(0xB, keys[SDL_SCANCODE_C]);
-        emulator.setKey(0xF, keys[SDL_SCANCODE_V]);
+                    default:
+                        break;
+                }
+            }
+        }
 
-        /* -------------------- CPU -------------------- */
-        for (int i = 0; i < CYCLES_PER_FRAME; ++i) {
-            emulator.emulateCycle();
+        // The device stays quiet while the debugger holds the emulator
+        bool halted = shared.halted.load(std::memory_order_relaxed);
+        if (audioDevice && halted != audioPaused) {
+            SDL_PauseAudioDevice(audioDevice, halted ? 1 : 0);
+            audioPaused = halted;
         }
 
+        /* -------------------- INPUT -------------------- */
+        // One atomic store for the whole keypad
+        shared.keys.store(readKeypad(), std::memory_order_relaxed);
+        shared.rewinding.store(SDL_GetKeyboardState(nullptr)[SDL_SCANCODE_BACKSPACE] != 0,
+                               std::memory_order_relaxed);
+
         /* -------------------- RENDER -------------------- */
-        if (emulator.shouldDraw()) {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
+        if (shared.frames.fetch()) {
+            const framePacket& frame = shared.frames.readBuffer();
 
-            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            uint8_t* gfx = emulator.getDisplay();
+            // Upload only the span of rows that differ from what's shown
+            // (everything after a resolution change)
+            int first = 0;
+            int last = frame.height - 1;
+            if (frame.width == shownWidth) {
+                auto same = [&](int y) {
+                    return std::memcmp(frame.rows[0][y], shownRows[0][y], sizeof(shownRows[0][y])) == 0
+                        && std::memcmp(frame.rows[1][y], shownRows[1][y], sizeof(shownRows[1][y])) == 0;
+                };
+                while (first <= last && same(first))
+                    ++first;
+                while (last >= first && same(last))
+                    --last;
+            }
 
-            for (int y = 0; y < 32; ++y) {
-                for (int x = 0; x < 64; ++x) {
-                    if (gfx[x + y * 64]) {
-                        SDL_Rect r{ x * 10, y * 10, 10, 10 };
-                        SDL_RenderFillRect(renderer, &r);
+            if (first <= last) {
+                SDL_Rect rect{ 0, first, frame.width, last - first + 1 };
+                void* pixels;
+                int pitch;
+                if (SDL_LockTexture(screen, &rect, &pixels, &pitch) == 0) {
+                    for (int y = first; y <= last; ++y) {
+                        Uint32* line = reinterpret_cast<Uint32*>(
+                                static_cast<uint8_t*>(pixels) + (y - first) * pitch);
+                        for (int b = 0; b < frame.width / 8; ++b) {
+                            int shift = 56 - 8 * (b & 7);
+                            uint8_t bits = static_cast<uint8_t>(frame.rows[0][y][b >> 3] >> shift);
+                            uint8_t bits2 = static_cast<uint8_t>(frame.rows[1][y][b >> 3] >> shift);
+                            if (!bits2) {
+                                std::memcpy(line + 8 * b, BYTE_PIXELS[bits], sizeof(BYTE_PIXELS[bits]));
+                                continue;
+                            }
+                            for (int bit = 0; bit < 8; ++bit) {
+                                int colour = ((bits >> (7 - bit)) & 1) | ((bits2 >> (7 - bit)) & 1) << 1;
+                                line[8 * b + bit] = PALETTE[colour];
+                            }
+                        }
                     }
+                    SDL_UnlockTexture(screen);
+
+                    std::memcpy(shownRows, frame.rows, sizeof(shownRows));
+                    shownWidth = frame.width;
                 }
             }
 
+            // One scaled copy of the visible part of the screen
+            SDL_Rect visible{ 0, 0, frame.width, frame.height };
+            SDL_RenderCopy(renderer, screen, &visible, nullptr);
             SDL_RenderPresent(renderer);
-            emulator.resetDrawFlag();
+        } else {
+            // Nothing new to show; don't spin
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        /* -------------------- STATS -------------------- */
+        auto now = clock::now();
+        double statsSeconds = std::chrono::duration<double>(now - statsStart).count();
+        if (statsSeconds >= 1.0) {
+            uint64_t cycles = shared.cycles.load(std::memory_order_relaxed);
+            char title[96];
+            std::snprintf(title, sizeof(title), "CHIP-8 Emulator - %.0f cycles/s%s",
+                          (cycles - statsCycles) / statsSeconds,
+                          shared.turbo.load() ? " [turbo]" : "");
+            SDL_SetWindowTitle(window, title);
+
+            statsStart = now;
+            statsCycles = cycles;
         }
+    }
+
+    shared.quit.store(true);
+    emulation.join();
+
+    if (audioDevice)
+        SDL_CloseAudioDevice(audioDevice);
+
+#ifdef CHIP8_PROFILE
+    // Profiling builds leave a report and flame-graph stacks next to the ROM
+    {
+        std::ofstream report(romPath + ".profile.txt");
+        emulator.getProfiler().writeReport(report);
+        std::ofstream folded(romPath + ".folded");
+        emulator.getProfiler().writeFolded(folded);
+    }
+#endif
 
-        std::this_thread::sleep_for(
-                std::chrono::milliseconds(FRAME_DELAY_MS)
-        );
+    if (settings.recording) {
+        try {
+            movie.finish(emulator);
+            movie.save(recordPath);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+        }
+    }
+
+    if (settings.capture) {
+        try {
+            capture.close();
+            if (capture.dropped())
+                std::cerr << "Capture dropped " << capture.dropped() << " of " << capture.frameCount() << " frames\n";
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+        }
     }
 
+    SDL_DestroyTexture(screen);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -0,0 +1,180 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "movie.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+static void putBytes(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i)
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+static void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+// Bounds-checked reader over the loaded file
+struct movieReader {
+    const std::vector<uint8_t>& data;
+    size_t pos = 0;
+
+    uint64_t bytes(int count) {
+        if (pos + count > data.size())
+            throw std::runtime_error("Input movie is truncated");
+
+        uint64_t v = 0;
+        for (int i = 0; i < count; ++i)
+            v |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+        return v;
+    }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = static_cast<uint8_t>(bytes(1));
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        throw std::runtime_error("Bad cycle delta in input movie");
+    }
+};
+
+void inputMovie::begin(const chip8& emulator, uint64_t s) {
+    seed = s;
+    cpuHz = emulator.getCpuHz();
+    quirks = emulator.getQuirks();
+    romHash = emulator.getROMHash();
+    length = 0;
+    finalHash = 0;
+    events.clear();
+}
+
+void inputMovie::record(const chip8& emulator, uint16_t keys) {
+    uint16_t held = events.empty() ? 0 : events.back().keys;
+    if (keys == held)
+        return;
+
+    uint64_t cycle = emulator.getCycleCount();
+    if (!events.empty() && events.back().cycle == cycle) {
+        events.back().keys = keys; // several changes before the CPU ran again
+    } else {
+        events.push_back({ cycle, keys });
+    }
+}
+
+void inputMovie::finish(const chip8& emulator) {
+    length = emulator.getCycleCount();
+    finalHash = emulator.displayHash();
+}
+
+void inputMovie::save(const std::string& filename) const {
+    std::vector<uint8_t> out;
+    out.insert(out.end(), { 'C', '8', 'M', 'V' });
+    putBytes(out, VERSION, 2);
+    putBytes(out, static_cast<uint64_t>(quirks), 2);
+    putBytes(out, seed, 8);
+    putBytes(out, cpuHz, 4);
+    putBytes(out, romHash, 8);
+    putBytes(out, length, 8);
+    putBytes(out, finalHash, 8);
+    putBytes(out, events.size(), 4);
+
+    uint64_t last = 0;
+    for (const movieEvent& e : events) {
+        putVarint(out, e.cycle - last);
+        putBytes(out, e.keys, 2);
+        last = e.cycle;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(out.data()), out.size())) {
+        throw std::runtime_error("Failed to write input movie: " + filename);
+    }
+}
+
+inputMovie inputMovie::load(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open input movie: " + filename);
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    if (data.size() < 4 || std::memcmp(data.data(), "C8MV", 4) != 0) {
+        throw std::runtime_error("Not an input movie: " + filename);
+    }
+
+    movieReader in{ data, 4 };
+    if (in.bytes(2) != VERSION) {
+        throw std::runtime_error("Unsupported input movie version: " + filename);
+    }
+    uint64_t quirks = in.bytes(2);
+    if (quirks > static_cast<uint64_t>(quirkProfile::xochip)) {
+        throw std::runtime_error("Unknown quirk profile in input movie: " + filename);
+    }
+
+    inputMovie movie;
+    movie.quirks = static_cast<quirkProfile>(quirks);
+    movie.seed = in.bytes(8);
+    movie.cpuHz = static_cast<uint32_t>(in.bytes(4));
+    movie.romHash = in.bytes(8);
+    movie.length = in.bytes(8);
+    movie.finalHash = in.bytes(8);
+
+    uint64_t count = in.bytes(4);
+    uint64_t cycle = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        cycle += in.varint();
+        uint16_t keys = static_cast<uint16_t>(in.bytes(2));
+        movie.events.push_back({ cycle, keys });
+    }
+    return movie;
+}
+
+bool inputMovie::isMovie(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[4] = {};
+    return file.read(magic, 4) && std::memcmp(magic, "C8MV", 4) == 0;
+}
+
+void moviePlayer::prepare(chip8& emulator) const {
+    if (emulator.getROMHash() != movie.romHash) {
+        throw std::runtime_error("Input movie was recorded with a different ROM");
+    }
+
+    emulator.seed(movie.seed);
+    emulator.setCpuHz(movie.cpuHz);
+    emulator.setQuirks(movie.quirks);
+}
+
+uint64_t moviePlayer::runFor(chip8& emulator, uint64_t cycles) {
+    uint64_t done = 0;
+
+    while (done < cycles && !emulator.hasFault()) {
+        uint64_t now = emulator.getCycleCount();
+        while (nextEvent < movie.events.size() && movie.events[nextEvent].cycle <= now) {
+            emulator.setKeys(movie.events[nextEvent].keys);
+            ++nextEvent;
+        }
+
+        // Run straight through to the next key change
+        uint64_t slice = cycles - done;
+        if (nextEvent < movie.events.size() && movie.events[nextEvent].cycle - now < slice)
+            slice = movie.events[nextEvent].cycle - now;
+
+        uint64_t ran = emulator.runFor(slice);
+        done += ran;
+        if (ran < slice)
+            break;
+    }
+    return done;
+}
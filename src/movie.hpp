@@ -0,0 +1,87 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_MOVIE_HPP
+#define CHIP8_EMULATOR_MOVIE_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One keypad change: from `cycle` on, the keys in `keys` are held
+struct movieEvent {
+    uint64_t cycle;
+    uint16_t keys;
+};
+
+/*
+    Input movie: everything needed to replay a run bit for bit.
+
+    A replay boots a fresh chip8 with the same ROM, quirks, RNG seed and CPU speed,
+    and applies each key mask at exactly the recorded cycle. The cycle
+    counts the core's virtual time, so wall-clock timing never enters into
+    it.
+
+    File format (little-endian):
+        "C8MV", u16 version, u16 quirk profile (0 = legacy)
+        u64 seed, u32 cpu Hz, u64 ROM hash
+        u64 length in cycles, u64 display hash at the end
+        u32 event count
+        events: LEB128 cycle delta from the previous event, u16 key mask
+*/
+class inputMovie {
+
+public:
+    static constexpr uint16_t VERSION = 1;
+
+    uint64_t seed = 0;
+    uint32_t cpuHz = 600;
+    quirkProfile quirks = quirkProfile::legacy;
+    uint64_t romHash = 0;
+    uint64_t length = 0;        // cycles covered by the recording
+    uint64_t finalHash = 0;     // displayHash() after `length` cycles
+    std::vector<movieEvent> events;
+
+    // Start recording against an emulator that has just booted its ROM
+    void begin(const chip8& emulator, uint64_t seed);
+
+    // Note the keys held from the emulator's current cycle on. Nothing is
+    // stored unless the mask changed.
+    void record(const chip8& emulator, uint16_t keys);
+
+    // Close the recording at the emulator's current cycle
+    void finish(const chip8& emulator);
+
+    void save(const std::string& filename) const;
+    static inputMovie load(const std::string& filename);
+
+    // True if the file starts with the movie magic
+    static bool isMovie(const std::string& filename);
+};
+
+// Feeds a movie's key changes into an emulator at their exact cycles
+class moviePlayer {
+
+private:
+    const inputMovie& movie;
+    size_t nextEvent = 0;
+
+public:
+    explicit moviePlayer(const inputMovie& movie) : movie(movie) {}
+
+    // Seed, speed and quirks as the recording started
+    void prepare(chip8& emulator) const;
+
+    // Run up to `cycles`, splitting at every key change. Returns cycles run.
+    uint64_t runFor(chip8& emulator, uint64_t cycles);
+
+    // Run one 60 Hz frame with the recorded input
+    uint64_t runFrame(chip8& emulator) { return runFor(emulator, emulator.cyclesUntilFrame()); }
+
+    bool finished(const chip8& emulator) const { return emulator.getCycleCount() >= movie.length; }
+};
+
+#endif // CHIP8_EMULATOR_MOVIE_HPP
@@ -0,0 +1,227 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+// Deeper than any real CHIP-8 stack; stops a runaway sp from growing the tree
+static const int MAX_DEPTH = 64;
+static const uint16_t UNKNOWN_ENTRY = 0xFFFF;
+
+profiler::profiler() {
+    reset();
+}
+
+void profiler::reset() {
+    std::fill(std::begin(familyCounts), std::end(familyCounts), 0);
+    std::fill(std::begin(pcHits), std::end(pcHits), 0);
+    instructions = 0;
+
+    calls.clear();
+    calls.push_back({ 0x200, -1, 0, {} });
+    current = 0;
+    depth = 0;
+
+    drawCalls = 0;
+    frameDrawNs = 0;
+    totalDrawNs = 0;
+    maxFrameDrawNs = 0;
+    frames = 0;
+}
+
+unsigned profiler::familyIndex(uint16_t opcode) {
+    uint16_t mask;
+    switch (opcode >> 12) {
+        case 0x0:
+            if ((opcode & 0xFFF0) == 0x00C0) {
+                mask = 0xFFF0;      // 00CN
+            } else if ((opcode & 0xFF00) == 0x0000 && (opcode & 0x00FF) >= 0xE0) {
+                mask = 0xFFFF;      // 00E0, 00EE, 00FB-00FF
+            } else {
+                mask = 0xF000;
+            }
+            break;
+        case 0x5:
+        case 0x8:
+        case 0x9: mask = 0xF00F; break;
+        case 0xE:
+        case 0xF: mask = 0xF0FF; break;
+        default:  mask = 0xF000; break;
+    }
+
+    uint16_t key = opcode & mask;
+    return (key >> 12) << 8 | (key & 0xFF);
+}
+
+void profiler::familyName(unsigned index, char out[5]) {
+    unsigned top = (index >> 8) & 0xF;
+    unsigned low = index & 0xFF;
+
+    switch (top) {
+        case 0x0:
+            if (low == 0xC0) {
+                std::snprintf(out, 5, "00CN");
+            } else if (low) {
+                std::snprintf(out, 5, "00%02X", low);
+            } else {
+                std::snprintf(out, 5, "0NNN");
+            }
+            break;
+        case 0x1: case 0x2: case 0xA: case 0xB:
+            std::snprintf(out, 5, "%XNNN", top);
+            break;
+        case 0x5: case 0x8: case 0x9:
+            std::snprintf(out, 5, "%XXY%X", top, low & 0xF);
+            break;
+        case 0xD:
+            std::snprintf(out, 5, "DXYN");
+            break;
+        case 0xE: case 0xF:
+            if (top == 0xF && (low == 0x00 || low == 0x02)) {
+                std::snprintf(out, 5, "F0%02X", low);   // XO-CHIP F000, F002
+            } else {
+                std::snprintf(out, 5, "%XX%02X", top, low);
+            }
+            break;
+        default:
+            std::snprintf(out, 5, "%XXNN", top);
+            break;
+    }
+}
+
+int profiler::enterCall(uint16_t entry) {
+    for (int child : calls[current].children) {
+        if (calls[child].entry == entry)
+            return child;
+    }
+
+    calls.push_back({ entry, current, 0, {} });
+    int node = static_cast<int>(calls.size()) - 1;
+    calls[current].children.push_back(node);
+    return node;
+}
+
+void profiler::syncStack(uint16_t pc, uint16_t sp) {
+    int target = std::min<int>(sp, MAX_DEPTH);
+
+    // Returned (or a state was loaded): climb back up
+    while (depth > target) {
+        current = calls[current].parent;
+        --depth;
+    }
+
+    // Called: the instruction about to run is the subroutine's first.
+    // Levels skipped over at once (a loaded state) have no known entry.
+    while (depth < target) {
+        ++depth;
+        current = enterCall(depth == target ? pc : UNKNOWN_ENTRY);
+    }
+}
+
+void profiler::endFrame() {
+    ++frames;
+    totalDrawNs += frameDrawNs;
+    maxFrameDrawNs = std::max(maxFrameDrawNs, frameDrawNs);
+    frameDrawNs = 0;
+}
+
+void profiler::writeReport(std::ostream& out) const {
+    char line[96];
+    double total = instructions ? static_cast<double>(instructions) : 1.0;
+
+    std::snprintf(line, sizeof(line), "instructions: %llu\n\n",
+                  static_cast<unsigned long long>(instructions));
+    out << line;
+
+    /* -------------------- OPCODE FAMILIES -------------------- */
+    std::vector<unsigned> families;
+    for (unsigned i = 0; i < 4096; ++i) {
+        if (familyCounts[i])
+            families.push_back(i);
+    }
+    std::sort(families.begin(), families.end(), [this](unsigned a, unsigned b) {
+        return familyCounts[a] > familyCounts[b];
+    });
+
+    out << "opcode family       count       share\n";
+    for (unsigned f : families) {
+        char name[5];
+        familyName(f, name);
+        std::snprintf(line, sizeof(line), "%-8s %16llu %10.2f%%\n", name,
+                      static_cast<unsigned long long>(familyCounts[f]),
+                      100.0 * familyCounts[f] / total);
+        out << line;
+    }
+
+    /* -------------------- HOT ADDRESSES -------------------- */
+    std::vector<uint16_t> addresses;
+    for (uint16_t a = 0; a < 4096; ++a) {
+        if (pcHits[a])
+            addresses.push_back(a);
+    }
+    std::sort(addresses.begin(), addresses.end(), [this](uint16_t a, uint16_t b) {
+        return pcHits[a] > pcHits[b];
+    });
+    if (addresses.size() > 32)
+        addresses.resize(32);
+
+    out << "\nhottest addresses   count       share\n";
+    for (uint16_t a : addresses) {
+        std::snprintf(line, sizeof(line), "0x%03X    %16llu %10.2f%%\n", a,
+                      static_cast<unsigned long long>(pcHits[a]),
+                      100.0 * pcHits[a] / total);
+        out << line;
+    }
+
+    /* -------------------- DXYN -------------------- */
+    uint64_t drawNs = totalDrawNs + frameDrawNs;
+    uint64_t frameCount = frames ? frames : 1;
+    out << "\nDXYN\n";
+    std::snprintf(line, sizeof(line), "  calls            %llu\n",
+                  static_cast<unsigned long long>(drawCalls));
+    out << line;
+    std::snprintf(line, sizeof(line), "  total            %.3f ms\n", drawNs / 1e6);
+    out << line;
+    std::snprintf(line, sizeof(line), "  frames           %llu\n",
+                  static_cast<unsigned long long>(frames));
+    out << line;
+    std::snprintf(line, sizeof(line), "  mean per frame   %.3f us\n", drawNs / 1e3 / frameCount);
+    out << line;
+    std::snprintf(line, sizeof(line), "  worst frame      %.3f us\n", maxFrameDrawNs / 1e3);
+    out << line;
+    if (drawCalls) {
+        std::snprintf(line, sizeof(line), "  per call         %.1f ns\n",
+                      static_cast<double>(drawNs) / drawCalls);
+        out << line;
+    }
+}
+
+void profiler::writeFolded(std::ostream& out) const {
+    for (size_t n = 0; n < calls.size(); ++n) {
+        if (!calls[n].selfCycles)
+            continue;
+
+        // Walk up to the root, then print the path top down
+        std::vector<uint16_t> path;
+        for (int node = static_cast<int>(n); node >= 0; node = calls[node].parent)
+            path.push_back(calls[node].entry);
+
+        std::string line;
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            char frame[16];
+            if (it == path.rbegin()) {
+                std::snprintf(frame, sizeof(frame), "main");
+            } else if (*it == UNKNOWN_ENTRY) {
+                std::snprintf(frame, sizeof(frame), ";sub_unknown");
+            } else {
+                std::snprintf(frame, sizeof(frame), ";sub_%03X", *it);
+            }
+            line += frame;
+        }
+
+        out << line << ' ' << calls[n].selfCycles << '\n';
+    }
+}
@@ -0,0 +1,108 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_PROFILER_HPP
+#define CHIP8_EMULATOR_PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/*
+    Hot-path profiler, only built in with -DCHIP8_PROFILE=ON.
+
+    The core calls step() before every instruction with the PC, the raw
+    opcode and the stack depth. From those it keeps:
+      - a count per opcode family (8XY4, FX55, ...)
+      - a hit count for every address in the 4 KiB space
+      - a tree of call stacks, rebuilt from changes in sp: when sp grows
+        the instruction being run is the first one of the new subroutine,
+        when it shrinks we pop back to that depth
+    DXYN is timed separately and summed per 60 Hz frame.
+
+    Without CHIP8_PROFILE none of this is compiled, and chip8 carries no
+    profiler at all.
+*/
+class profiler {
+
+private:
+    // Opcode families packed into 12 bits: top nibble, then low byte with
+    // the operand nibbles masked out
+    uint64_t familyCounts[4096] = {};
+    uint64_t pcHits[4096] = {};
+    uint64_t instructions = 0;
+
+    // One node per distinct call path
+    struct callNode {
+        uint16_t entry;                 // address the subroutine was entered at
+        int parent;
+        uint64_t selfCycles = 0;
+        std::vector<int> children;
+    };
+    std::vector<callNode> calls;
+    int current = 0;
+    int depth = 0;
+
+    // DXYN time
+    uint64_t drawCalls = 0;
+    uint64_t frameDrawNs = 0;
+    uint64_t totalDrawNs = 0;
+    uint64_t maxFrameDrawNs = 0;
+    uint64_t frames = 0;
+
+    int enterCall(uint16_t entry);
+
+public:
+    profiler();
+
+    void step(uint16_t pc, uint16_t opcode, uint16_t sp) {
+        ++instructions;
+        ++pcHits[pc & 0x0FFF];
+        ++familyCounts[familyIndex(opcode)];
+
+        if (sp != depth)
+            syncStack(pc, sp);
+        ++calls[current].selfCycles;
+    }
+
+    void syncStack(uint16_t pc, uint16_t sp);
+
+    void addDrawTime(uint64_t ns) {
+        ++drawCalls;
+        frameDrawNs += ns;
+    }
+    void endFrame();
+
+    void reset();
+
+    // Text report: opcode mix, hottest addresses, DXYN time per frame
+    void writeReport(std::ostream& out) const;
+
+    // One "entry;entry;... cycles" line per call path, for flamegraph.pl
+    // and friends
+    void writeFolded(std::ostream& out) const;
+
+    static unsigned familyIndex(uint16_t opcode);
+    static void familyName(unsigned index, char out[5]);
+};
+
+// Adds the lifetime of the scope to the profiler's DXYN time
+class drawTimer {
+
+private:
+    profiler& prof;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit drawTimer(profiler& prof) : prof(prof), start(std::chrono::steady_clock::now()) {}
+    ~drawTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        prof.addDrawTime(static_cast<uint64_t>(ns));
+    }
+};
+
+#endif // CHIP8_EMULATOR_PROFILER_HPP
@@ -0,0 +1,67 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "quirks.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+const char* quirkProfileName(quirkProfile profile) {
+    switch (profile) {
+        case quirkProfile::legacy: return "legacy";
+        case quirkProfile::chip8:  return "chip8";
+        case quirkProfile::schip:  return "schip";
+        case quirkProfile::xochip: return "xochip";
+    }
+    return "?";
+}
+
+bool parseQuirkProfile(const std::string& name, quirkProfile& out) {
+    static const quirkProfile ALL[] = {
+            quirkProfile::legacy, quirkProfile::chip8, quirkProfile::schip, quirkProfile::xochip
+    };
+
+    for (quirkProfile profile : ALL) {
+        if (name == quirkProfileName(profile)) {
+            out = profile;
+            return true;
+        }
+    }
+    return false;
+}
+
+void quirkDatabase::load(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open quirk database: " + filename);
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+
+        std::istringstream fields(line);
+        uint64_t romHash;
+        std::string name;
+        if (!(fields >> std::hex >> romHash))
+            continue; // blank line
+
+        quirkProfile profile;
+        if (!(fields >> name) || !parseQuirkProfile(name, profile))
+            throw std::runtime_error("Bad line in quirk database " + filename + ": " + line);
+
+        profiles[romHash] = profile;
+    }
+}
+
+bool quirkDatabase::lookup(uint64_t romHash, quirkProfile& out) const {
+    auto it = profiles.find(romHash);
+    if (it == profiles.end())
+        return false;
+
+    out = it->second;
+    return true;
+}
@@ -0,0 +1,114 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_QUIRKS_HPP
+#define CHIP8_EMULATOR_QUIRKS_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/*
+    Quirk profiles: the places where CHIP-8 interpreters from different
+    eras disagree.
+
+    Each profile is a set of compile-time constants. The opcode handlers
+    that care are templates over the profile, and decode<Q>() picks the
+    matching instantiation once per instruction address, so the hot path
+    never tests a quirk flag at run time.
+
+        shiftUsesVY           8XY6/8XYE shift VY into VX (COSMAC) instead of shifting VX
+        logicResetsVF         8XY1/8XY2/8XY3 clear VF
+        jumpUsesVX            BNNN jumps to XNN + VX instead of NNN + V0
+        indexOverflowFlag     FX1E sets VF when I passes 0xFFF
+        loadStoreIncrementsI  FX55/FX65 leave I pointing past the last register
+        clipSprites           sprites are cut off at the screen edges instead of wrapping
+        superChip             SUPER-CHIP display: 128 × 64 hi-res (00FE/00FF), 16 × 16
+                              sprites (DXY0) and scrolling (00CN/00FB/00FC)
+        xoChip                XO-CHIP: I reaches all 64 KiB (F000 NNNN), two bitplanes
+                              (FN01), 5XY2/5XY3 and the audio pattern (F002/FX3A)
+*/
+
+// What this emulator has always done, so existing recordings keep working
+struct legacyQuirks {
+    static constexpr bool shiftUsesVY = false;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool jumpUsesVX = false;
+    static constexpr bool indexOverflowFlag = true;
+    static constexpr bool loadStoreIncrementsI = false;
+    static constexpr bool clipSprites = false;
+    static constexpr bool superChip = false;
+    static constexpr bool xoChip = false;
+};
+
+// COSMAC VIP CHIP-8
+struct chip8Quirks {
+    static constexpr bool shiftUsesVY = true;
+    static constexpr bool logicResetsVF = true;
+    static constexpr bool jumpUsesVX = false;
+    static constexpr bool indexOverflowFlag = false;
+    static constexpr bool loadStoreIncrementsI = true;
+    static constexpr bool clipSprites = true;
+    static constexpr bool superChip = false;
+    static constexpr bool xoChip = false;
+};
+
+// SUPER-CHIP 1.1 (HP48)
+struct schipQuirks {
+    static constexpr bool shiftUsesVY = false;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool jumpUsesVX = true;
+    static constexpr bool indexOverflowFlag = false;
+    static constexpr bool loadStoreIncrementsI = false;
+    static constexpr bool clipSprites = true;
+    static constexpr bool superChip = true;
+    static constexpr bool xoChip = false;
+};
+
+// XO-CHIP (Octo)
+struct xochipQuirks {
+    static constexpr bool shiftUsesVY = true;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool jumpUsesVX = false;
+    static constexpr bool indexOverflowFlag = false;
+    static constexpr bool loadStoreIncrementsI = true;
+    static constexpr bool clipSprites = false;
+    static constexpr bool superChip = true;
+    static constexpr bool xoChip = true;
+};
+
+// Run-time name for a profile (command line, movies, ROM database)
+enum class quirkProfile : uint8_t {
+    legacy,
+    chip8,
+    schip,
+    xochip
+};
+
+const char* quirkProfileName(quirkProfile profile);
+
+// Returns false if `name` isn't a profile
+bool parseQuirkProfile(const std::string& name, quirkProfile& out);
+
+/*
+    ROM hash -> profile table, so a front end can pick the right quirks
+    without being told. Text file, one ROM per line, '#' starts a comment:
+        <ROM hash in hex, as from chip8::getROMHash()> <profile>
+*/
+class quirkDatabase {
+
+private:
+    std::unordered_map<uint64_t, quirkProfile> profiles;
+
+public:
+    // Throws if the file can't be read or has a bad line
+    void load(const std::string& filename);
+
+    // Returns false if the ROM isn't listed
+    bool lookup(uint64_t romHash, quirkProfile& out) const;
+
+    size_t size() const { return profiles.size(); }
+};
+
+#endif // CHIP8_EMULATOR_QUIRKS_HPP
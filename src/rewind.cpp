@@ -0,0 +1,116 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "rewind.hpp"
+#include <cstring>
+
+// Snapshots are diffed in chunks: memory in 64-byte pages, the display one
+// row (two words) of one plane at a time, and the CPU state in 16-byte pieces.
+// The header never changes, so it isn't tracked.
+static const size_t PAGE_SIZE = 64;
+static const size_t MEMORY_CHUNKS = MEMORY_SIZE / PAGE_SIZE;
+static const size_t GFX_CHUNKS = 2 * 64;
+static const size_t CPU_CHUNK_SIZE = 16;
+static const size_t CPU_SIZE = saveStateLayout::SIZE - saveStateLayout::CPU;
+static const size_t CPU_CHUNKS = (CPU_SIZE + CPU_CHUNK_SIZE - 1) / CPU_CHUNK_SIZE;
+static const size_t CHUNK_COUNT = MEMORY_CHUNKS + GFX_CHUNKS + CPU_CHUNKS;
+
+// Records we keep around for reuse instead of freeing
+static const size_t MAX_SPARE_RECORDS = 64;
+
+static void chunkBounds(size_t index, size_t& offset, size_t& size) {
+    if (index < MEMORY_CHUNKS) {
+        offset = saveStateLayout::MEMORY + index * PAGE_SIZE;
+        size = PAGE_SIZE;
+    } else if (index < MEMORY_CHUNKS + GFX_CHUNKS) {
+        offset = saveStateLayout::GFX + (index - MEMORY_CHUNKS) * saveStateLayout::ROW_SIZE;
+        size = saveStateLayout::ROW_SIZE;
+    } else {
+        size_t cpuOffset = (index - MEMORY_CHUNKS - GFX_CHUNKS) * CPU_CHUNK_SIZE;
+        offset = saveStateLayout::CPU + cpuOffset;
+        size = (CPU_SIZE - cpuOffset < CPU_CHUNK_SIZE) ? CPU_SIZE - cpuOffset : CPU_CHUNK_SIZE;
+    }
+}
+
+static size_t recordBytes(size_t chunks, size_t bytes) {
+    return chunks * sizeof(uint16_t) + bytes + 64; // 64 ~ bookkeeping per record
+}
+
+rewindBuffer::rewindBuffer(size_t maxBytes) : maxBytes(maxBytes) {
+}
+
+void rewindBuffer::push(const chip8& emulator) {
+    if (current.empty()) {
+        emulator.saveState(current);
+        return;
+    }
+
+    emulator.saveState(scratch);
+
+    undoRecord record;
+    if (!spare.empty()) {
+        record = std::move(spare.back());
+        spare.pop_back();
+        record.chunks.clear();
+        record.bytes.clear();
+    }
+
+    // Remember what the changed chunks looked like at the previous snapshot
+    for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+        size_t offset, size;
+        chunkBounds(i, offset, size);
+
+        if (std::memcmp(current.data() + offset, scratch.data() + offset, size) != 0) {
+            record.chunks.push_back(static_cast<uint16_t>(i));
+            record.bytes.insert(record.bytes.end(),
+                                current.data() + offset, current.data() + offset + size);
+        }
+    }
+
+    current.swap(scratch);
+
+    usedBytes += recordBytes(record.chunks.size(), record.bytes.size());
+    history.push_back(std::move(record));
+
+    while (usedBytes > maxBytes && !history.empty())
+        dropOldest();
+}
+
+bool rewindBuffer::rewind(chip8& emulator) {
+    if (history.empty())
+        return false;
+
+    undoRecord& record = history.back();
+
+    const uint8_t* src = record.bytes.data();
+    for (uint16_t i : record.chunks) {
+        size_t offset, size;
+        chunkBounds(i, offset, size);
+        std::memcpy(current.data() + offset, src, size);
+        src += size;
+    }
+
+    emulator.loadState(current);
+
+    usedBytes -= recordBytes(record.chunks.size(), record.bytes.size());
+    if (spare.size() < MAX_SPARE_RECORDS)
+        spare.push_back(std::move(record));
+    history.pop_back();
+    return true;
+}
+
+void rewindBuffer::dropOldest() {
+    undoRecord& record = history.front();
+    usedBytes -= recordBytes(record.chunks.size(), record.bytes.size());
+
+    if (spare.size() < MAX_SPARE_RECORDS)
+        spare.push_back(std::move(record));
+    history.pop_front();
+}
+
+void rewindBuffer::clear() {
+    history.clear();
+    current.clear();
+    usedBytes = 0;
+}
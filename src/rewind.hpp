@@ -0,0 +1,56 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_REWIND_HPP
+#define CHIP8_EMULATOR_REWIND_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Rewind history built from save states.
+//
+// The buffer keeps the most recent snapshot in full. Every push stores an
+// undo record holding only the pieces of the state that changed since the
+// snapshot before it: 64-byte memory pages, display rows and 16-byte
+// chunks of the CPU state. Rewinding applies the newest undo record.
+// When the history grows past its byte budget, the oldest records are
+// dropped.
+class rewindBuffer {
+
+private:
+    struct undoRecord {
+        std::vector<uint16_t> chunks;  // indexes of the changed chunks
+        std::vector<uint8_t> bytes;    // their old contents, back to back
+    };
+
+    std::vector<uint8_t> current;      // state at the newest snapshot
+    std::vector<uint8_t> scratch;
+    std::deque<undoRecord> history;
+    std::vector<undoRecord> spare;     // recycled records, no per-frame allocation
+
+    size_t maxBytes;
+    size_t usedBytes = 0;
+
+    void dropOldest();
+
+public:
+    explicit rewindBuffer(size_t maxBytes = 8 << 20);
+
+    // Snapshot the emulator (call once per frame)
+    void push(const chip8& emulator);
+
+    // Step the emulator back one snapshot. Returns false when the history
+    // is empty.
+    bool rewind(chip8& emulator);
+
+    void clear();
+
+    size_t frames() const { return history.size(); }
+    size_t bytes() const { return usedBytes; }
+};
+
+#endif // CHIP8_EMULATOR_REWIND_HPP
@@ -0,0 +1,280 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "rom_library.hpp"
+#include "chip8.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Largest image that fits above 0x200
+static const size_t MAX_ROM_SIZE = MEMORY_SIZE - 0x200;
+
+/* -------------------- MAPPED FILES -------------------- */
+
+// A whole file mapped read-only, unmapped on destruction. Empty files
+// map to nothing (data() is nullptr).
+class mappedFile {
+
+private:
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    explicit mappedFile(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Failed to open ROM: " + path);
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to read ROM: " + path);
+        }
+        length = static_cast<size_t>(size.QuadPart);
+
+        if (length) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping)
+                base = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        CloseHandle(file);
+
+        if (length && !base) {
+            if (mapping)
+                CloseHandle(mapping);
+            throw std::runtime_error("Failed to map ROM: " + path);
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open ROM: " + path);
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to read ROM: " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+
+        if (length) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Failed to map ROM: " + path);
+            }
+            base = static_cast<const uint8_t*>(p);
+        }
+        close(fd); // the mapping keeps the file alive
+#endif
+    }
+
+    ~mappedFile() {
+#ifdef _WIN32
+        if (base)
+            UnmapViewOfFile(base);
+        if (mapping)
+            CloseHandle(mapping);
+#else
+        if (base)
+            munmap(const_cast<uint8_t*>(base), length);
+#endif
+    }
+
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+};
+
+/* -------------------- PACK FORMAT -------------------- */
+
+static const uint32_t PACK_VERSION = 1;
+static const size_t PACK_HEADER = 12;
+
+static uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t read64(const uint8_t* p) {
+    return read32(p) | (static_cast<uint64_t>(read32(p + 4)) << 32);
+}
+
+static void write16(std::ostream& out, uint16_t v) {
+    char b[2] = { static_cast<char>(v & 0xFF), static_cast<char>(v >> 8) };
+    out.write(b, 2);
+}
+
+static void write32(std::ostream& out, uint32_t v) {
+    write16(out, v & 0xFFFF);
+    write16(out, v >> 16);
+}
+
+static void write64(std::ostream& out, uint64_t v) {
+    write32(out, v & 0xFFFFFFFF);
+    write32(out, v >> 32);
+}
+
+/* -------------------- LIBRARY -------------------- */
+
+romLibrary::romLibrary() = default;
+romLibrary::~romLibrary() = default;
+
+void romLibrary::addEntry(const std::string& name, const uint8_t* data, size_t size, uint64_t hash) {
+    roms.push_back({ name, data, size, hash });
+
+    // First one in wins, for names and for duplicate images alike
+    byName.emplace(name, roms.size() - 1);
+    byHash.emplace(hash, roms.size() - 1);
+}
+
+bool romLibrary::isPack(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    return in.read(magic, 4) && std::memcmp(magic, "C8PK", 4) == 0;
+}
+
+void romLibrary::add(const std::string& path) {
+    if (std::filesystem::is_directory(path)) {
+        addDirectory(path);
+    } else if (isPack(path)) {
+        addPack(path);
+    } else {
+        addFile(path);
+    }
+}
+
+void romLibrary::addDirectory(const std::string& dir) {
+    std::error_code error;
+    std::filesystem::directory_iterator it(dir, error);
+    if (error)
+        throw std::runtime_error("Failed to open ROM directory: " + dir);
+
+    for (const auto& item : it) {
+        if (!item.is_regular_file())
+            continue;
+
+        // Anything that can't be a ROM (empty, too big) is skipped, so a
+        // stray file in the directory doesn't stop the whole library
+        uintmax_t size = item.file_size(error);
+        if (error || size == 0 || size > MAX_ROM_SIZE)
+            continue;
+
+        files.push_back(std::make_unique<mappedFile>(item.path().string()));
+        const mappedFile& file = *files.back();
+        addEntry(item.path().filename().string(), file.data(), file.size(),
+                 chip8::hashROM(file.data(), file.size()));
+    }
+}
+
+void romLibrary::addFile(const std::string& path) {
+    auto file = std::make_unique<mappedFile>(path);
+    if (file->size() > MAX_ROM_SIZE) {
+        throw std::runtime_error("ROM too large to fit in memory");
+    }
+
+    addEntry(std::filesystem::path(path).filename().string(), file->data(), file->size(),
+             chip8::hashROM(file->data(), file->size()));
+    files.push_back(std::move(file));
+}
+
+void romLibrary::addPack(const std::string& path) {
+    files.push_back(std::make_unique<mappedFile>(path));
+    const uint8_t* base = files.back()->data();
+    size_t size = files.back()->size();
+
+    auto bad = [&path] {
+        return std::runtime_error("Bad ROM pack: " + path);
+    };
+
+    if (size < PACK_HEADER || std::memcmp(base, "C8PK", 4) != 0)
+        throw bad();
+    if (read32(base + 4) != PACK_VERSION)
+        throw std::runtime_error("Unsupported ROM pack version: " + path);
+
+    uint32_t count = read32(base + 8);
+    size_t at = PACK_HEADER;
+
+    // The index stores each hash, so a pack of thousands of ROMs opens
+    // without reading any of them
+    for (uint32_t i = 0; i < count; ++i) {
+        if (size - at < 18)
+            throw bad();
+
+        uint64_t hash = read64(base + at);
+        uint32_t offset = read32(base + at + 8);
+        uint32_t length = read32(base + at + 12);
+        uint16_t nameLength = base[at + 16] | (base[at + 17] << 8);
+        at += 18;
+
+        if (size - at < nameLength || offset > size || length > size - offset || length > MAX_ROM_SIZE)
+            throw bad();
+
+        std::string name(reinterpret_cast<const char*>(base + at), nameLength);
+        at += nameLength;
+        addEntry(name, base + offset, length, hash);
+    }
+}
+
+const romEntry* romLibrary::find(const std::string& name) const {
+    auto it = byName.find(name);
+    if (it == byName.end())
+        it = byName.find(std::filesystem::path(name).filename().string());
+
+    return it == byName.end() ? nullptr : &roms[it->second];
+}
+
+const romEntry* romLibrary::find(uint64_t hash) const {
+    auto it = byHash.find(hash);
+    return it == byHash.end() ? nullptr : &roms[it->second];
+}
+
+void romLibrary::writePack(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to write ROM pack: " + path);
+    }
+
+    // Lay the images out right after the index
+    size_t offset = PACK_HEADER;
+    for (const romEntry& rom : roms)
+        offset += 18 + rom.name.size();
+
+    out.write("C8PK", 4);
+    write32(out, PACK_VERSION);
+    write32(out, static_cast<uint32_t>(roms.size()));
+
+    for (const romEntry& rom : roms) {
+        write64(out, rom.hash);
+        write32(out, static_cast<uint32_t>(offset));
+        write32(out, static_cast<uint32_t>(rom.size));
+        write16(out, static_cast<uint16_t>(rom.name.size()));
+        out.write(rom.name.data(), static_cast<std::streamsize>(rom.name.size()));
+        offset += rom.size;
+    }
+
+    for (const romEntry& rom : roms)
+        out.write(reinterpret_cast<const char*>(rom.data), static_cast<std::streamsize>(rom.size));
+
+    if (!out) {
+        throw std::runtime_error("Failed to write ROM pack: " + path);
+    }
+}
@@ -0,0 +1,77 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_ROM_LIBRARY_HPP
+#define CHIP8_EMULATOR_ROM_LIBRARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class mappedFile;
+
+// One ROM in the library. `data` points straight into a mapped file.
+struct romEntry {
+    std::string name;   // file name, or the name stored in the pack
+    const uint8_t* data;
+    size_t size;
+    uint64_t hash;      // chip8::hashROM(), the key quirk databases and movies use
+};
+
+/*
+    A set of ROMs memory-mapped from directories and pack files, indexed
+    by name and by content hash.
+
+    Nothing is read or copied up front: each file is mapped once, hashed
+    once, and every chip8 that boots a ROM copies it straight from the
+    mapping (chip8::loadROM(entry.data, entry.size, entry.hash)).
+    Entries stay valid for the library's lifetime, and lookups are safe
+    from any number of threads once loading is done.
+
+    Pack file (little-endian), for libraries too big to keep as loose
+    files:
+        "C8PK", u32 version, u32 count
+        count × { u64 hash, u32 offset, u32 size, u16 name length, name }
+        ROM images, each at its offset from the start of the file
+*/
+class romLibrary {
+
+private:
+    std::vector<std::unique_ptr<mappedFile>> files;
+    std::vector<romEntry> roms;
+    std::unordered_map<std::string, size_t> byName;
+    std::unordered_map<uint64_t, size_t> byHash;
+
+    void addEntry(const std::string& name, const uint8_t* data, size_t size, uint64_t hash);
+
+public:
+    romLibrary();
+    ~romLibrary();
+    romLibrary(const romLibrary&) = delete;
+    romLibrary& operator=(const romLibrary&) = delete;
+
+    // A directory (every regular file in it), a pack, or a single ROM.
+    // Throws if the path can't be read or a pack is malformed.
+    void add(const std::string& path);
+    void addDirectory(const std::string& dir);
+    void addPack(const std::string& path);
+    void addFile(const std::string& path);
+
+    // By name, then by the file name part of `name`. nullptr if missing.
+    const romEntry* find(const std::string& name) const;
+    const romEntry* find(uint64_t hash) const;
+
+    const std::vector<romEntry>& entries() const { return roms; }
+    size_t size() const { return roms.size(); }
+
+    // Write every ROM in the library to one pack file
+    void writePack(const std::string& path) const;
+
+    static bool isPack(const std::string& path);
+};
+
+#endif // CHIP8_EMULATOR_ROM_LIBRARY_HPP
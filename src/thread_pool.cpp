@@ -0,0 +1,214 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <exception>
+
+// The pool and worker index running on this thread (null and -1 outside
+// any pool), so tasks submitted from inside a task land on the submitting
+// worker's deque
+static thread_local const threadPool* currentPool = nullptr;
+static thread_local long currentWorker = -1;
+
+threadPool::threadPool(unsigned threads) {
+    if (threads == 0)
+        threads = 1;
+
+    for (unsigned i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<workQueue>());
+
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back([this, i] { workerLoop(i); });
+}
+
+threadPool::~threadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+
+    for (std::thread& t : workers)
+        t.join();
+}
+
+void threadPool::submit(std::function<void()> task) {
+    size_t target = (currentPool == this)
+            ? static_cast<size_t>(currentWorker)
+            : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Bump under sleepLock so a worker can't miss the wakeup between
+        // checking `queued` and going to sleep
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    wakeWorkers.notify_one();
+}
+
+bool threadPool::popLocal(size_t self, std::function<void()>& task) {
+    workQueue& q = *queues[self];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty())
+        return false;
+
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool threadPool::steal(size_t self, std::function<void()>& task) {
+    for (size_t n = 1; n < queues.size(); ++n) {
+        workQueue& q = *queues[(self + n) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty())
+            continue;
+
+        // A lone task is also the back one. Taking it from there keeps
+        // the deque where it is; popping the front walks it forward, and
+        // it allocates a new block every 16 steals or so.
+        task = std::move(q.tasks.front());
+        if (q.tasks.size() == 1) {
+            q.tasks.pop_back();
+        } else {
+            q.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+bool threadPool::takeNewest(std::function<void()>& task) {
+    // The calling worker's own deque first, then the others, newest task
+    // first: what was just submitted is the likeliest to be wanted
+    size_t first = currentPool == this ? static_cast<size_t>(currentWorker) : 0;
+    for (size_t n = 0; n < queues.size(); ++n) {
+        workQueue& q = *queues[(first + n) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty())
+            continue;
+
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+void threadPool::runTask(std::function<void()>& task) {
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    task = nullptr;
+
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        allDone.notify_all();
+    }
+}
+
+void threadPool::workerLoop(size_t self) {
+    currentPool = this;
+    currentWorker = static_cast<long>(self);
+    std::function<void()> task;
+
+    while (true) {
+        if (popLocal(self, task) || steal(self, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wakeWorkers.wait(guard, [this] {
+            return stopping || queued.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+void threadPool::wait() {
+    std::unique_lock<std::mutex> guard(sleepLock);
+    allDone.wait(guard, [this] {
+        return pending.load(std::memory_order_acquire) == 0;
+    });
+}
+
+void threadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0)
+        return;
+
+    // Tasks and the caller claim chunks off a shared counter until none
+    // are left: uneven chunks even out without stealing, and a call
+    // submits no more tasks than there are workers. The tasks hold a
+    // single pointer, small enough for std::function to keep without
+    // allocating.
+    struct sharedRange {
+        const std::function<void(size_t)>* fn;
+        size_t count;
+        size_t chunkSize;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> running{0};     // submitted tasks not yet finished
+
+        std::mutex lock;
+        std::condition_variable finished;
+        std::exception_ptr error;           // the first exception fn threw
+
+        void work() {
+            try {
+                size_t begin;
+                while ((begin = next.fetch_add(chunkSize, std::memory_order_relaxed)) < count) {
+                    size_t end = std::min(count, begin + chunkSize);
+                    for (size_t i = begin; i < end; ++i)
+                        (*fn)(i);
+                }
+            } catch (...) {
+                // Skip whatever chunks are left and hand the error to the caller
+                next.store(count, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> guard(lock);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    } range;
+    range.fn = &fn;
+    range.count = count;
+    range.chunkSize = std::max<size_t>(1, count / (static_cast<size_t>(size()) * 8));
+
+    size_t tasks = std::min<size_t>(size(), (count + range.chunkSize - 1) / range.chunkSize - 1);
+    range.running.store(tasks, std::memory_order_relaxed);
+    for (size_t t = 0; t < tasks; ++t) {
+        submit([&range] {
+            range.work();
+
+            // Count down under the lock: the caller takes it before it
+            // returns, so range outlives this task's last touch of it
+            std::lock_guard<std::mutex> guard(range.lock);
+            if (range.running.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                range.finished.notify_all();
+        });
+    }
+    range.work();
+
+    // Wait for this call's tasks only, running queued tasks meanwhile:
+    // ours may sit behind slow work, or behind the task that called us.
+    // Once nothing is queued anywhere they are all running elsewhere, and
+    // blocking is safe. The final wait takes the lock even if running
+    // already reads zero, since the last task may still be holding it.
+    std::function<void()> task;
+    while (range.running.load(std::memory_order_acquire) != 0 && takeNewest(task))
+        runTask(task);
+    {
+        std::unique_lock<std::mutex> guard(range.lock);
+        range.finished.wait(guard, [&range] { return range.running.load(std::memory_order_acquire) == 0; });
+    }
+
+    if (range.error)
+        std::rethrow_exception(range.error);
+}
@@ -0,0 +1,69 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_THREAD_POOL_HPP
+#define CHIP8_EMULATOR_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a deque: it pops its own work from the back and,
+// when empty, steals from the front of the other workers' deques.
+class threadPool {
+
+private:
+    struct workQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<workQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> queued{0};    // tasks sitting in a deque
+    std::atomic<size_t> pending{0};   // tasks submitted but not finished
+    std::atomic<size_t> nextQueue{0}; // round-robin target for outside submits
+    bool stopping = false;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeWorkers;
+    std::condition_variable allDone;
+
+    bool popLocal(size_t self, std::function<void()>& task);
+    bool steal(size_t self, std::function<void()>& task);
+    bool takeNewest(std::function<void()>& task);
+    void runTask(std::function<void()>& task);
+    void workerLoop(size_t self);
+
+public:
+    explicit threadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~threadPool();
+
+    threadPool(const threadPool&) = delete;
+    threadPool& operator=(const threadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task has finished
+    void wait();
+
+    // Run fn(i) for i in [0, count), split into chunks across the workers
+    // and the calling thread. Returns once this call's chunks are done,
+    // whatever else the pool is running; safe to call from a task. If fn
+    // throws, chunks not yet started are skipped and the first exception
+    // is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+};
+
+#endif // CHIP8_EMULATOR_THREAD_POOL_HPP
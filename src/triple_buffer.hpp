@@ -0,0 +1,52 @@
+//
+// Created by patel on 2026-10-16.
+//
+
+#ifndef CHIP8_EMULATOR_TRIPLE_BUFFER_HPP
+#define CHIP8_EMULATOR_TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer / single-consumer triple buffer.
+//
+// The producer fills writeBuffer() and calls publish(). The consumer calls
+// fetch() and then reads readBuffer(). Neither side ever waits for the
+// other. The consumer always gets the newest published value, and
+// values published in between are simply overwritten.
+template <typename T>
+class tripleBuffer {
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;   // middle slot holds an unread value
+
+    T buffers[3];
+    std::atomic<uint8_t> middle{1};         // slot being handed over (+ FRESH bit)
+    uint8_t writeIndex = 0;                 // owned by the producer
+    uint8_t readIndex = 2;                  // owned by the consumer
+
+public:
+    T& writeBuffer() { return buffers[writeIndex]; }
+
+    // Hand the write buffer over and take back whichever slot was in the middle
+    void publish() {
+        uint8_t old = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+        writeIndex = old & INDEX_MASK;
+    }
+
+    // Swap in the newest published value. Returns false if nothing new was
+    // published since the last fetch (readBuffer() is then unchanged).
+    bool fetch() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+
+        uint8_t old = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = old & INDEX_MASK;
+        return true;
+    }
+
+    const T& readBuffer() const { return buffers[readIndex]; }
+};
+
+#endif // CHIP8_EMULATOR_TRIPLE_BUFFER_HPP